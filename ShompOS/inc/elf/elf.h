@@ -152,11 +152,17 @@ typedef struct
 #define NOT_ELF_FILE   2
 #define ELF_UNREADABLE 3
 
-// Reads and starts execution of ELF file.
+// Limits on the arguments passed to a program, including the pointers
+#define ELF_MAX_ARGS 16
+#define ELF_MAX_ARG_BYTES 512
+
+// Reads and starts execution of ELF file, calling its entry point as
+// main(argc, argv). argv is NULL terminated and copied, so it may be
+// freed once this returns. Returns the PID, or -1 on failure.
 // Doesn't use virtual memory; rather, it allocates one
 // contiguous block for all loadable segments. This causes
 // issues with the .bss section.
-processID init_elf(ramfs_file_t* f);
+processID init_elf(ramfs_file_t* f, char* const argv[]);
 
 // Check if the file is readable. Returns 0 without error.
 int is_readable(ramfs_file_t* f);
@@ -10,6 +10,14 @@ typedef struct _list_header {
     struct _list_header* prev;
 } list_header;
 
+// recovers a pointer to the struct that embeds a list_header (or any other
+// member) from a pointer to that member.
+#define container_of(ptr, type, member) \
+    ((type*)((char*)(ptr) - offsetof(type, member)))
+
 bool is_end_of_list(list_header* node);
 bool is_head_of_list(list_header* node);
+void init_list(list_header* head);
+void list_add_tail(list_header* head, list_header* node);
+void list_remove(list_header* node);
 int max(int a, int b);
@@ -0,0 +1,55 @@
+// ring_buffer.h
+// Lock-free fixed size ring buffers for passing items between interrupt
+// handlers and processes
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// the producer and consumer indices live on separate cache lines so the two
+// sides don't keep stealing the same line from each other.
+#define RING_CACHE_LINE 64
+#define __ring_aligned __attribute__((aligned(RING_CACHE_LINE)))
+
+// single producer, single consumer. head and tail count items ever popped and
+// pushed, so tail - head is the fill level even after the counters wrap.
+// capacity must be a power of 2.
+typedef struct _ring_buffer {
+    volatile uint32_t head __ring_aligned;  // written only by the consumer
+    volatile uint32_t tail __ring_aligned;  // written only by the producer
+    uint8_t* data __ring_aligned;
+    uint32_t item_size;
+    uint32_t mask;
+} ring_buffer;
+
+// multiple producers, single consumer. producers claim a slot by moving tail
+// with lock cmpxchg, then publish it through the slot's sequence number, so a
+// producer interrupted between the two never lets the consumer see a half
+// written item. capacity must be a power of 2.
+typedef struct _mpsc_ring_buffer {
+    volatile uint32_t head __ring_aligned;  // written only by the consumer
+    volatile uint32_t tail __ring_aligned;  // claimed by producers with cmpxchg
+    uint8_t* slots __ring_aligned;
+    uint32_t item_size;
+    uint32_t slot_size;
+    uint32_t mask;
+} mpsc_ring_buffer;
+
+// bytes of storage the caller must provide for each kind of ring
+#define RING_STORAGE_SIZE(item_size, capacity) ((item_size) * (capacity))
+#define MPSC_SLOT_SIZE(item_size) ((sizeof(uint32_t) + (item_size) + 3) & ~3u)
+#define MPSC_RING_STORAGE_SIZE(item_size, capacity) (MPSC_SLOT_SIZE(item_size) * (capacity))
+
+void ring_init(ring_buffer* ring, void* storage, uint32_t item_size, uint32_t capacity);
+bool ring_push(ring_buffer* ring, const void* item);
+bool ring_pop(ring_buffer* ring, void* item);
+bool ring_empty(ring_buffer* ring);
+uint32_t ring_count(ring_buffer* ring);
+
+void mpsc_ring_init(mpsc_ring_buffer* ring, void* storage, uint32_t item_size, uint32_t capacity);
+bool mpsc_ring_push(mpsc_ring_buffer* ring, const void* item);
+bool mpsc_ring_pop(mpsc_ring_buffer* ring, void* item);
+bool mpsc_ring_empty(mpsc_ring_buffer* ring);
@@ -0,0 +1,36 @@
+// mmap.h
+// Mapping ramfs file contents into processes
+// Cedarville University 2024-25 OSDev Team
+
+#ifndef MMAP_H
+#define MMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ramfs.h>
+
+#define MAX_MMAP_REGIONS 0x20
+
+// protection for mmap(). a read-only mapping inside one chunk of the file
+// shares the file's own data. anything else is private to the process and
+// never written back.
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
+
+// there is no paging, so a shared mapping is the file's data itself, pinned
+// so ramfs doesn't free it, and a private mapping is a copy made up
+// front rather than on the first write.
+typedef struct _mmap_region {
+    void* addr;
+    size_t len;
+    ramfs_file_t* file;     // pinned file for shared mappings, NULL if private
+    processID owner;        // process (thread group) that mapped it
+    bool in_use;
+} mmap_region;
+
+void* mmap_file(int fd, size_t offset, size_t len, int prot);
+int munmap_region(void* addr, size_t len);
+void munmap_process(processID owner);
+
+#endif // MMAP_H
@@ -23,6 +23,7 @@
 #define O_WRONLY 0x0002
 #define O_RDWR   0x0003
 #define O_APPEND 0x0004
+#define O_TRUNC  0x0008
 
 #ifndef _SSIZE_T_DEFINED
 typedef long ssize_t;
@@ -35,41 +36,127 @@ typedef long off_t;
 #endif
 
 #include <stddef.h> // For size_t
+#include <stdint.h>
+#include <process/process.h> // For wait_queue
+#include <memory/heap.h>     // For block_header
 
-// File structure
+// Capacity of a pipe's ring buffer. Writers block once this much is unread.
+#define PIPE_BUFFER_SIZE 512
+
+// Initial slots in a directory's name index (power of 2). It doubles once
+// three quarters of the slots are in use
+#define RAMFS_INDEX_MIN 8
+
+// One slot of a name index. entry is NULL if the slot was never used and
+// RAMFS_INDEX_DELETED if its entry was removed, so probes run past it
+typedef struct ramfs_index_slot {
+    uint32_t hash;              // Hash of the entry's name
+    void *entry;                // The ramfs_file_t or ramfs_dir_t
+} ramfs_index_slot_t;
+
+#define RAMFS_INDEX_DELETED ((void *)1)
+
+// Open addressing hash table from names to directory entries
+typedef struct ramfs_index {
+    ramfs_index_slot_t *slots;
+    size_t capacity;            // Number of slots, a power of 2
+    size_t used;                // Slots holding an entry or RAMFS_INDEX_DELETED
+} ramfs_index_t;
+
+// File contents are split into chunks of this many bytes, each filling a 4KB
+// heap block. Appends never move what is already written, and files can
+// outgrow the largest heap block. A file that is mmapped is re-chunked into
+// bigger blocks first, up to RAMFS_CHUNK_MAX, so the mapping can be shared
+#define RAMFS_CHUNK_SIZE (4096 - sizeof(block_header))
+#define RAMFS_CHUNK_MAX ((1 << MAX_BLOCK_SCALE) - sizeof(block_header))
+
+// Smallest files, subdirs and chunks array. They double when full and
+// halve once only a quarter full
+#define RAMFS_ARRAY_MIN 4
+
+// File structure. name must stay first: the name index reads it from files
+// and directories alike
 typedef struct ramfs_file {
-    char *name;         // File name
-    char *data;         // File contents
-    size_t size;        // File size
+    char *name;             // File name
+    char **chunks;          // Contents. A NULL chunk is a hole and reads as 0s
+    size_t chunk_count;     // Chunks in use, enough to cover size
+    size_t chunk_capacity;  // Room in chunks
+    size_t chunk_size;      // Bytes per chunk, RAMFS_CHUNK_SIZE until mmapped
+    size_t size;            // File size
+    size_t map_count;       // Shared mmaps of a chunk. The file can't be deleted
 } ramfs_file_t;
 
-// Directory structure
+// Directory structure. name must stay first, as in ramfs_file_t
 typedef struct ramfs_dir {
     char *name;                  // Directory name
     struct ramfs_dir *parent;    // Parent directory
     struct ramfs_file **files;   // Array of files in this directory
     size_t file_count;           // Number of files
+    size_t file_capacity;        // Room in files
     struct ramfs_dir **subdirs;  // Array of subdirectories
     size_t subdir_count;         // Number of subdirectories
+    size_t subdir_capacity;      // Room in subdirs
+    ramfs_index_t file_index;    // files by name
+    ramfs_index_t subdir_index;  // subdirs by name
 } ramfs_dir_t;
 
+// Path cache. Resolved paths, including ones that don't exist, are kept in
+// RAMFS_DCACHE_SIZE direct mapped slots (power of 2). Paths of
+// RAMFS_DCACHE_PATH_MAX bytes or more are never cached
+#define RAMFS_DCACHE_SIZE 64
+#define RAMFS_DCACHE_PATH_MAX 64
+
+// One cached path. Only valid while generation matches the tree's, which
+// changes on every create, delete and rename
+typedef struct ramfs_dentry {
+    uint32_t hash;               // Hash of base, path and is_dir
+    uint32_t generation;         // 0 if the slot is empty
+    ramfs_dir_t *base;           // Directory the path is relative to
+    bool is_dir;                 // Looked up as a directory, not a file
+    void *target;                // What it resolved to. NULL if nothing
+    char path[RAMFS_DCACHE_PATH_MAX];
+} ramfs_dentry_t;
+
+// Pipe structure. head and tail count bytes ever read and written, so
+// tail - head is the number of unread bytes even after they wrap.
+typedef struct ramfs_pipe {
+    char buffer[PIPE_BUFFER_SIZE];
+    size_t head;                 // Total bytes read
+    size_t tail;                 // Total bytes written
+    int readers;                 // Open read ends
+    int writers;                 // Open write ends
+    wait_queue read_waiters;     // Readers blocked on an empty pipe
+    wait_queue write_waiters;    // Writers blocked on a full pipe
+} ramfs_pipe_t;
+
 // File descriptor structure
 typedef struct {
     int fd;                 // File descriptor number
     ramfs_file_t *file;     // Pointer to the file
+    ramfs_pipe_t *pipe;     // Pointer to the pipe (NULL for regular files)
     size_t position;        // Current position in the file
     int flags;              // Open flags (read, write, etc.)
 } ramfs_fd_t;
 
 extern ramfs_fd_t *fd_table[MAX_FDS];
 extern int fd_count;
+// The root mounted by kernel_main, which syscall paths are relative to
+extern ramfs_dir_t *system_root;
 
 // Function prototypes for RAMFS operations
 ramfs_dir_t *ramfs_create_root();
 ramfs_file_t *ramfs_create_file(ramfs_dir_t *dir, const char *name, const char *data, size_t size);
-void ramfs_delete_file(ramfs_dir_t *dir, const char *name);
+int ramfs_delete_file(ramfs_dir_t *dir, const char *name);
+int ramfs_rename(ramfs_dir_t *root, const char *old_path, const char *new_path);
+void ramfs_dcache_invalidate();
 ramfs_dir_t *ramfs_create_dir(ramfs_dir_t *parent, const char *name);
+size_t ramfs_file_read(ramfs_file_t *file, size_t offset, void *buf, size_t count);
+char *ramfs_file_span(ramfs_file_t *file, size_t offset, size_t len);
+int ramfs_file_coalesce(ramfs_file_t *file);
+ramfs_file_t *ramfs_lookup_file(ramfs_dir_t *dir, const char *name, size_t len);
+ramfs_dir_t *ramfs_lookup_dir(ramfs_dir_t *dir, const char *name, size_t len);
 ramfs_dir_t *ramfs_find_dir(ramfs_dir_t *root, const char *path);
+ramfs_file_t *ramfs_find_file(ramfs_dir_t *root, const char *path);
 ramfs_dir_t *init_fs();
 int init_mnt(ramfs_dir_t *mnt);
 
@@ -79,6 +166,7 @@ ssize_t ramfs_read(int fd, void *buf, size_t count);
 ssize_t ramfs_write(int fd, const void *buf, size_t count);
 off_t ramfs_seek(int fd, off_t offset, int origin);
 int ramfs_close(int fd);
+int ramfs_pipe(int fds[2]);
 void test_fd_system(ramfs_dir_t *root);
 int init_stdio(ramfs_dir_t *root);
 
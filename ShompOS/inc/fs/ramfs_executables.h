@@ -13,8 +13,11 @@ void ramfs_cat(ramfs_dir_t *dir, const char *filename);
 void ramfs_touch(ramfs_dir_t *dir, const char *filename);
 void ramfs_mkdir(ramfs_dir_t *dir, const char *dirname);
 void ramfs_rm(ramfs_dir_t *dir, const char *filename);
-ramfs_dir_t *ramfs_cd(ramfs_dir_t *root, const char *filename);
-void ramfs_run(ramfs_dir_t *dir, const char *filename);
+void ramfs_mv(ramfs_dir_t *dir, const char *old_path, const char *new_path);
+ramfs_dir_t *ramfs_cd(ramfs_dir_t *dir, const char *filename);
+// Starts a program. cmdline is its name, then arguments separated by spaces.
+// Returns the PID, or -1 on failure
+int ramfs_run(ramfs_dir_t *dir, const char *cmdline);
 
 
 #endif // RAMFS_EXECUTABLES_H
@@ -5,10 +5,22 @@
 // ----- Assembly functions -----
 extern void load_gdt();
 extern void syscall_handler();
+extern void sysenter_handler();
+extern uint32_t init_sysenter();
+extern uint32_t syscall_int80(uint32_t number);
+extern uint32_t syscall_sysenter(uint32_t number);
 extern void keyboard_handler();
 extern void clock_handler();
 extern char ioport_in(uint16_t port);
 extern void ioport_out(uint16_t port, uint8_t data);
 extern void load_idt(uint32_t* idt_address);
 extern void enable_interrupts();
-extern void* isr_stub_table[];
\ No newline at end of file
+extern uint32_t save_and_disable_interrupts();
+extern void restore_interrupts(uint32_t eflags);
+extern uint64_t read_tsc();
+extern void* isr_stub_table[];
+
+// ----- Linker symbols -----
+// first and last byte (exclusive) of the kernel image
+extern char kernel_start[];
+extern char kernel_end[];
\ No newline at end of file
@@ -26,6 +26,20 @@ typedef struct _KEY_state {
 	uint8_t shift : 1;
 } KEY_state;
 
+// latency counters for one IRQ: how long its handler kept interrupts off
+typedef struct _IRQ_stats {
+	uint32_t count;
+	uint64_t total_cycles;
+	uint32_t max_cycles;
+} IRQ_stats;
+
+#define IRQ_CLOCK 0
+#define IRQ_KEYBOARD 1
+#define IRQ_STATS_COUNT 2
+
+void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
 void terminal_writeint(int number);
 void terminal_clear();
+void handle_keyboard_interrupt();
+void record_irq_latency(IRQ_stats* stats, uint64_t start);
@@ -0,0 +1,43 @@
+// timer.h
+// Hierarchical timer wheel driven by the PIT
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+#include <fake_libc/fake_libc.h>
+
+// PIT will trigger an interrupt at a rate of PIT_FREQUENCY / divisor Hz
+// 0xFFFF results in around 18.3 Hz, the slowest possible with 16 bits
+#define PIT_FREQUENCY 1193180
+#define PIT_DIVISOR 0xFFF
+#define TICKS_PER_SECOND (PIT_FREQUENCY / PIT_DIVISOR)
+#define MS_TO_TICKS(ms) (((ms) * TICKS_PER_SECOND + 999) / 1000)
+
+// the wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots. a slot
+// on level n covers 64^n ticks, so the whole wheel reaches 2^24 ticks ahead.
+// timers further out than that are clamped to the last slot.
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_MAX_DELAY ((1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+typedef void (*timer_callback)(void* arg);
+
+// a pending timer. owned by the caller (usually embedded in a larger struct
+// or on the stack) so arming one never allocates. callbacks run inside the
+// clock interrupt and must not block. zero the struct before its first use.
+typedef struct _timer_struct {
+    list_header list;     // must be first. links the timer into a wheel slot
+    uint32_t expires;     // absolute tick the timer fires on
+    timer_callback callback;
+    void* arg;
+} timer_struct;
+
+void init_timers();
+void add_timer(timer_struct* timer, uint32_t ticks, timer_callback callback, void* arg);
+void cancel_timer(timer_struct* timer);
+bool timer_pending(timer_struct* timer);
+void advance_timers();
+uint32_t get_ticks();
@@ -0,0 +1,15 @@
+// vdso_page.h
+// Kernel side of the data page programs read without a syscall
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+#include <vdso.h>
+
+// the page itself. its layout is in mnt/inc/vdso.h
+extern vdso_data vdso_page_data;
+
+void init_vdso();
+void vdso_tick(uint64_t tsc);
+void vdso_set_active(uint32_t pid, uint32_t tid);
@@ -24,6 +24,7 @@ void* allocate(size_t request_size);
 uint8_t free(void* data);
 int8_t brk(void* addr);
 int8_t sbrk(int32_t inc);
+bool heap_contains(const void* addr, size_t size);
 
 // ----- FOR DEBUGGING ------
 void print_free_counts();
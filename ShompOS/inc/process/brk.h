@@ -0,0 +1,26 @@
+// brk.h
+// Per process program break, for user space allocators
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+#include <process/process.h>
+#include <memory/heap.h>
+#include <syscall_spec.h>
+
+// there is no paging, so a program's break can't be a region of its own
+// address space. instead it is carved from chunks of the kernel heap, each
+// one max size block with a list_header in front linking it to the process.
+// the break grows contiguously inside a chunk. a request that doesn't fit in
+// what is left starts a new chunk, so allocators must treat each sbrk()
+// result as its own run of memory.
+#define BRK_CHUNK_ALLOC ((1 << MAX_BLOCK_SCALE) - sizeof(block_header))
+#define BRK_CHUNK_SIZE (BRK_CHUNK_ALLOC - sizeof(list_header))
+
+// programs size their requests by the copy in the syscall ABI
+_Static_assert(BRK_CHUNK_SIZE == SBRK_CHUNK_SIZE, "SBRK_CHUNK_SIZE must match BRK_CHUNK_SIZE");
+
+void* process_sbrk(processID PID, int32_t increment);
+int process_brk(processID PID, void* addr);
+void release_process_brk(process_struct* proc);
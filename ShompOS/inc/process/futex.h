@@ -0,0 +1,19 @@
+// futex.h
+// Fast user-space mutex support: wait on an address, wake its waiters
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+
+// operations for the futex syscall. numbered as on Linux.
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+// waiters are spread over this many queues by address. a bucket may hold
+// waiters for several addresses, so each waiter records its own.
+#define FUTEX_HASH_BUCKETS 0x40
+
+void init_futex();
+int futex_wait(volatile uint32_t* addr, uint32_t expected, uint32_t timeout_ticks);
+uint32_t futex_wake(volatile uint32_t* addr, uint32_t count);
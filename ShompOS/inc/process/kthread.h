@@ -0,0 +1,27 @@
+// kthread.h
+// Kernel threads and a deferred work queue served by worker threads
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+#include <process/process.h>
+
+// kernel threads run ordinary kernel C code, so give them a real stack
+#define KTHREAD_STACK_SIZE 4000
+
+// pending work items. must be a power of 2
+#define WORK_QUEUE_SIZE 0x20
+#define WORKER_COUNT 2
+
+typedef void (*kthread_fn)(void* arg);
+
+// one deferred call
+typedef struct _work_item {
+    kthread_fn fn;
+    void* arg;
+} work_item;
+
+processID create_kthread(kthread_fn fn, void* arg);
+void init_workers();
+int queue_work(kthread_fn fn, void* arg);
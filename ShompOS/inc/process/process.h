@@ -3,11 +3,31 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <process/context_switch.h>
+#include <fake_libc/fake_libc.h>
+#include <kernel/timer.h>
 
 typedef uint32_t processID;
 
+// load averages are sampled this often, and kept as fixed point numbers with
+// LOAD_FIXED_SHIFT fractional bits. LOAD_EXP_n is exp(-5s/n min) in the same
+// format, the same constants Linux uses.
+#define LOAD_SAMPLE_TICKS (5 * TICKS_PER_SECOND)
+#define LOAD_FIXED_SHIFT 11
+#define LOAD_FIXED_1 (1 << LOAD_FIXED_SHIFT)
+#define LOAD_EXP_1 1884
+#define LOAD_EXP_5 2014
+#define LOAD_EXP_15 2037
+
+// deadline processes may reserve at most this share of the CPU, in 1/1024ths,
+// so normal processes are never starved outright.
+#define RT_UTILIZATION_SHIFT 10
+#define RT_MAX_UTILIZATION 972 // ~95%
+
+// the reaper only calls free(), so it needs little stack
+#define REAPER_STACK_SIZE 1000
+
 // Limit of how many processes can run at once
-#define MAX_PROCESS 0x8
+#define MAX_PROCESS 0x10
 // chosen arbitrarily, i like the word BLOB.
 #define MAX_PID 0xB10B 
 
@@ -15,21 +35,79 @@ typedef enum {
     STOPPED, // dead, will not run again
     ACTIVE,  // running currently
     WAITING, // waiting for its turn on the CPU 
-    SPAWNED  // initialized but not yet scheduled
+    SPAWNED, // initialized but not yet scheduled
+    BLOCKED, // sleeping until something calls wake_process()
+    ZOMBIE   // exited. waiting for the reaper to free its memory, and if it
+             // is joinable, for its exit status to be collected
 } process_status;
 
+// a list of processes blocked until some event happens
+typedef struct _wait_queue {
+    list_header waiters;
+} wait_queue;
+
 typedef struct _process_struct {
     context_struct context;
     processID PID;
+    processID TGID;         // thread group: the PID of the group's first thread
+    processID parent;       // the process that may waitpid() for it, 0 if none
     process_status status;
     void* entry_point;
+    void* image;            // memory a program was loaded into, freed on exit
+    void* start_routine;    // what a kernel or user thread runs, see kthread.h
+    void* start_arg;        // and thread.h
+    int exit_status;        // what a thread's start routine or main returned
+    bool joinable;          // keep the exit status until someone collects it
+    wait_queue exit_waiters; // blocked in thread_join() or waitpid() on this one
     uint32_t wait_time;
+    list_header wait_link;  // links the process into a wait_queue while blocked
+    void* wait_key;         // what the process is waiting on, if a queue is shared
+    timer_struct sleep_timer; // sleep_process() or futex timeout, cancelled if killed
+    int stdio[3];           // what the process' fds 0-2 refer to in fd_table
+    void* io_ring;          // batched I/O ring from io_ring_setup(), if any
+    // ----- program break, see brk.h. only used in the group leader -----
+    list_header brk_chunks; // every chunk the break has used, freed on exit
+    char* brk_start;        // first byte of the current chunk
+    char* brk;              // the break itself
+    char* brk_limit;        // end of the current chunk
+    // ----- accounting -----
+    uint32_t user_ticks;    // clock ticks that landed in a loaded program
+    uint32_t kernel_ticks;  // clock ticks that landed in the kernel image
+    uint64_t run_cycles;    // TSC cycles spent on the CPU
+    uint64_t switched_in;   // TSC when the process last got the CPU
+    uint32_t switch_count;  // times the process was switched onto the CPU
+    uint32_t last_run;      // tick the process last got the CPU
+    // ----- deadline class. all 0 for a normal process -----
+    uint32_t rt_runtime;    // ticks of CPU guaranteed every period
+    uint32_t rt_deadline;   // ticks after a period starts that runtime is due by
+    uint32_t rt_period;     // ticks between replenishments
+    uint32_t rt_budget;     // ticks of runtime left in the current period
+    uint32_t rt_due;        // absolute tick of the current deadline
+    uint32_t rt_replenish;  // absolute tick the next period starts
     // uint8_t max_fd;
     // file_descriptor* fd_list;
 } process_struct;
 
 
 processID init_process(void* entry_point, void* stack);
+process_struct* get_process(processID PID);
 void kill_process(processID PID);
+void release_process(process_struct* proc);
+void exit_process(int status);
+int wait_process(processID PID, int* status);
+void init_reaper();
 void switch_process(processID PID);
-void switch_process_from_queue();
\ No newline at end of file
+void switch_process_from_queue();
+processID get_active_pid();
+void block_process();
+void wake_process(processID PID);
+void sleep_process(uint32_t ticks);
+void init_wait_queue(wait_queue* queue);
+int wait_on_queue(wait_queue* queue);
+uint32_t wake_queue(wait_queue* queue, uint32_t count);
+int get_process_stdio(processID PID, int stdio_fd);
+int set_process_stdio(processID PID, int stdio_fd, int fd);
+void init_process_accounting();
+void account_process_tick(uint32_t eip);
+void print_process_table();
+int set_process_deadline(processID PID, uint32_t runtime, uint32_t deadline, uint32_t period);
\ No newline at end of file
@@ -0,0 +1,42 @@
+// shm.h
+// Named shared memory regions for inter-process communication
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <process/process.h>
+
+#define MAX_SHM_REGIONS 0x10
+#define SHM_NAME_LEN 0x10
+#define MAX_SHM_ATTACH 0x08  // processes attached to one region at a time
+#define SHM_NO_OWNER ((processID)-1)  // the owner exited
+
+// there is no paging yet, so every process already sees the same physical
+// memory. "mapping" a region hands back its one address, which is the same in
+// every process, and ownership moves between processes without a copy.
+// a region lives while anyone is attached, and while its owner is alive
+// and hasn't unlinked it.
+typedef struct _shm_region {
+    char name[SHM_NAME_LEN];
+    void* base;
+    size_t size;
+    processID attached[MAX_SHM_ATTACH];  // TGIDs of the attached processes
+    uint32_t attach_count;  // entries in attached
+    processID owner;        // TGID allowed to hand the region on and unlink it
+    bool unlinked;          // name removed. freed once the last process detaches
+    uint32_t sequence;      // bumped by every shm_notify()
+    wait_queue waiters;     // processes blocked in shm_wait()
+    bool in_use;
+} shm_region;
+
+int shm_create(const char* name, size_t size);
+void* shm_attach(int id);
+int shm_detach(int id);
+void shm_detach_process(processID tgid);
+int shm_transfer(int id, processID new_owner);
+int shm_unlink(int id);
+uint32_t shm_notify(int id);
+uint32_t shm_wait(int id, uint32_t seen_sequence);
@@ -0,0 +1,17 @@
+// thread.h
+// User threads: extra schedulable contexts inside one process
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+#include <process/process.h>
+
+// each thread gets its own stack from the kernel heap
+#define THREAD_STACK_SIZE 4000
+
+// a thread's exit status is what its start routine returns
+typedef int (*thread_fn)(void* arg);
+
+processID thread_create(thread_fn fn, void* arg);
+int thread_join(processID TID, int* status);
@@ -0,0 +1,47 @@
+// syscall_trace.h
+// Optional per-syscall counters, latency histograms and a log of recent calls
+// Cedarville University 2024-25 OSDev Team
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <process/process.h>
+
+// what to record. both dispatchers in boot.S test syscall_trace_flags once
+// per call and only come through here when it is set.
+#define SYSCALL_TRACE_STATS 0x1 // counts and latency histograms per syscall
+#define SYSCALL_TRACE_LOG   0x2 // the last SYSCALL_LOG_SIZE calls, like strace
+
+// bucket n counts calls that took 2^n to 2^(n+1)-1 cycles. the last bucket
+// also holds everything slower
+#define SYSCALL_HIST_BUCKETS 24
+#define SYSCALL_LOG_SIZE 64
+// events print_syscall_log() shows
+#define SYSCALL_LOG_SHOWN 16
+
+typedef struct _syscall_stats {
+    uint32_t count;
+    uint64_t total_cycles;
+    uint32_t histogram[SYSCALL_HIST_BUCKETS];
+} syscall_stats;
+
+// cycles are from entry to return, so calls that block count the wait too.
+// a call that never returned, like exit, stays not done
+typedef struct _syscall_event {
+    uint32_t sequence;      // which call this is, to spot a reused slot
+    processID PID;          // the calling thread
+    uint32_t number;
+    uint32_t args[3];       // the first three arguments
+    uint32_t result;
+    uint32_t cycles;
+    bool done;
+} syscall_event;
+
+extern volatile uint32_t syscall_trace_flags;
+
+void set_syscall_trace(uint32_t flags, processID TGID);
+void clear_syscall_trace();
+uint32_t syscall_traced(uint32_t number, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi, uint32_t edi, uint32_t ebp);
+void print_syscall_stats();
+void print_syscall_log();
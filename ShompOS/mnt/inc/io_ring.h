@@ -0,0 +1,76 @@
+// io_ring.h
+// Batched I/O: a submission ring and a completion ring shared with the kernel
+// Cedarville University 2024-25 OSDev Team
+
+// a program asks for a ring with io_ring_setup(), fills submission entries
+// (SQEs) and then makes one io_ring_enter() call to have the kernel run all
+// of them. each finished operation leaves a completion entry (CQE) carrying
+// the user_data of its SQE and what the equivalent syscall would have
+// returned. heads and tails count entries ever consumed and produced, so
+// tail - head is the number waiting even after they wrap.
+
+#ifndef IO_RING_H
+#define IO_RING_H
+
+#include <stdint.h>
+
+// entries in each ring. must be a power of 2
+#define IO_RING_ENTRIES 32
+#define IO_RING_MASK (IO_RING_ENTRIES - 1)
+
+// operations. they behave like read, write, open and close.
+#define IO_OP_NOP   0
+#define IO_OP_READ  1
+#define IO_OP_WRITE 2
+#define IO_OP_OPEN  3   // addr is the path, len the open flags
+#define IO_OP_CLOSE 4
+
+typedef struct _io_sqe {
+    uint32_t op;
+    int32_t fd;
+    uint32_t addr;          // buffer or path
+    uint32_t len;
+    uint32_t user_data;     // copied to the completion untouched
+} io_sqe;
+
+typedef struct _io_cqe {
+    uint32_t user_data;
+    int32_t result;
+} io_cqe;
+
+// the program writes sq_tail and cq_head, the kernel sq_head and cq_tail.
+// each side's counters sit on their own cache line.
+typedef struct _io_ring {
+    volatile uint32_t sq_head __attribute__((aligned(64)));
+    volatile uint32_t cq_tail;
+    volatile uint32_t sq_tail __attribute__((aligned(64)));
+    volatile uint32_t cq_head;
+    io_sqe sqes[IO_RING_ENTRIES] __attribute__((aligned(64)));
+    io_cqe cqes[IO_RING_ENTRIES];
+} io_ring;
+
+// returns: the next free submission entry, or NULL if the ring is full.
+//          it is handed to the kernel by io_ring_queue()
+static inline io_sqe *io_ring_get_sqe(io_ring *ring) {
+    if (ring->sq_tail - __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE) == IO_RING_ENTRIES) return 0;
+    return &ring->sqes[ring->sq_tail & IO_RING_MASK];
+}
+
+// queues the entry from io_ring_get_sqe(). the kernel sees it on the next
+// io_ring_enter()
+static inline void io_ring_queue(io_ring *ring) {
+    __atomic_store_n(&ring->sq_tail, ring->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+// returns: the oldest completion, or NULL if there is none
+static inline io_cqe *io_ring_peek_cqe(io_ring *ring) {
+    if (ring->cq_head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) return 0;
+    return &ring->cqes[ring->cq_head & IO_RING_MASK];
+}
+
+// frees the completion from io_ring_peek_cqe() for the kernel to reuse
+static inline void io_ring_cqe_seen(io_ring *ring) {
+    __atomic_store_n(&ring->cq_head, ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+#endif // IO_RING_H
@@ -0,0 +1,242 @@
+/*
+~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles  -m32 -fPIE -c -o malloc.o malloc.c
+*/
+
+#include "syscalls.h"
+#include "mutex.h"
+#include "malloc.h"
+
+// every block starts with this. the caller's memory follows it, 8 byte
+// aligned. bin is MALLOC_BIN_COUNT for large blocks
+typedef struct {
+    uint32_t bin;
+    uint32_t size;          // usable bytes after the header
+} block_header;
+
+// a free block keeps its list link where the caller's data was
+typedef struct free_block {
+    struct free_block *next;
+} free_block;
+
+typedef struct {
+    volatile uint32_t owner;    // TID + 1 of the thread using it, 0 if free
+    free_block *bins[MALLOC_BIN_COUNT];
+    uint32_t counts[MALLOC_BIN_COUNT];
+} thread_cache;
+
+// everything below is shared by all threads and guarded by heap_lock,
+// except each thread_cache, which only its owner touches
+static mutex_t heap_lock = MUTEX_INITIALIZER;
+static free_block *bins[MALLOC_BIN_COUNT];
+static free_block *large_blocks;
+static char *arena;
+static char *arena_end;
+static thread_cache caches[MALLOC_TCACHE_SLOTS];
+
+// copies and fills are written out by hand: there is no libc, and gcc would
+// otherwise turn the loops back into memcpy and memset calls
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void __copy(char *dest, const char *src, size_t n) {
+    while (n--) *dest++ = *src++;
+}
+
+__attribute__((optimize("no-tree-loop-distribute-patterns")))
+static void __zero(char *dest, size_t n) {
+    while (n--) *dest++ = 0;
+}
+
+// returns: the bin for a request, or MALLOC_BIN_COUNT if it is too big
+static uint32_t __size_to_bin(size_t size) {
+    size_t total = size + sizeof(block_header);
+    uint32_t scale = 32 - __builtin_clz(total - 1);
+    return scale > MALLOC_MIN_SHIFT ? scale - MALLOC_MIN_SHIFT : 0;
+}
+
+// returns: the calling thread's cache, or NULL if every slot is taken. a
+// thread's cache is found through its TID, read from the vDSO page so the
+// lookup costs no syscall
+static thread_cache *__thread_cache(void) {
+    uint32_t owner = vdso_gettid() + 1;
+    uint32_t i;
+
+    for (i = 0; i < MALLOC_TCACHE_SLOTS; i++) {
+        if (caches[i].owner == owner) return &caches[i];
+    }
+    for (i = 0; i < MALLOC_TCACHE_SLOTS; i++) {
+        if (__sync_bool_compare_and_swap(&caches[i].owner, 0, owner)) return &caches[i];
+    }
+    return 0;
+}
+
+// purpose: cuts a new block from the arena, asking the kernel for more
+//          when it runs out. call with heap_lock held
+// returns: the header of the block, or NULL if the kernel is out of memory
+static block_header *__carve(size_t bytes) {
+    if ((size_t)(arena_end - arena) < bytes) {
+        // take a whole chunk, keeping room to align it, which the kernel
+        // doesn't promise. what was left of the old arena is dropped
+        if (bytes > MALLOC_ARENA_SIZE - 8) return 0;
+        char *chunk = sbrk(MALLOC_ARENA_SIZE);
+        if (chunk == (char *)-1) return 0;
+        arena = (char *)(((uintptr_t)chunk + 7) & ~(uintptr_t)7);
+        arena_end = chunk + MALLOC_ARENA_SIZE;
+    }
+
+    block_header *block = (block_header *)arena;
+    arena += bytes;
+    return block;
+}
+
+// purpose: gets a block for one bin from the global list or the arena. call
+//          with heap_lock held
+static block_header *__bin_take(uint32_t bin) {
+    free_block *free_one = bins[bin];
+    if (free_one) {
+        bins[bin] = free_one->next;
+        return (block_header *)free_one - 1;
+    }
+
+    block_header *block = __carve((size_t)1 << (bin + MALLOC_MIN_SHIFT));
+    if (block) {
+        block->bin = bin;
+        block->size = (1 << (bin + MALLOC_MIN_SHIFT)) - sizeof(block_header);
+    }
+    return block;
+}
+
+static void *__malloc_large(size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    mutex_lock(&heap_lock);
+
+    free_block **link = &large_blocks;
+    block_header *block = 0;
+    while (*link) {
+        block_header *candidate = (block_header *)*link - 1;
+        if (candidate->size >= size) {
+            *link = (*link)->next;
+            block = candidate;
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    if (!block) {
+        block = __carve(size + sizeof(block_header));
+        if (block) {
+            block->bin = MALLOC_BIN_COUNT;
+            block->size = size;
+        }
+    }
+
+    mutex_unlock(&heap_lock);
+    return block ? block + 1 : 0;
+}
+
+void *malloc(size_t size) {
+    if (!size) return 0;
+
+    uint32_t bin = __size_to_bin(size);
+    if (bin >= MALLOC_BIN_COUNT) return __malloc_large(size);
+
+    thread_cache *cache = __thread_cache();
+    if (cache && !cache->bins[bin]) {
+        // refill the cache in one go, so the lock is taken once per batch
+        mutex_lock(&heap_lock);
+        for (int i = 0; i < MALLOC_TCACHE_BATCH; i++) {
+            block_header *block = __bin_take(bin);
+            if (!block) break;
+            free_block *free_one = (free_block *)(block + 1);
+            free_one->next = cache->bins[bin];
+            cache->bins[bin] = free_one;
+            cache->counts[bin]++;
+        }
+        mutex_unlock(&heap_lock);
+    }
+
+    if (cache) {
+        free_block *free_one = cache->bins[bin];
+        if (!free_one) return 0;
+        cache->bins[bin] = free_one->next;
+        cache->counts[bin]--;
+        return free_one;
+    }
+
+    mutex_lock(&heap_lock);
+    block_header *block = __bin_take(bin);
+    mutex_unlock(&heap_lock);
+    return block ? block + 1 : 0;
+}
+
+void free(void *ptr) {
+    if (!ptr) return;
+
+    block_header *block = (block_header *)ptr - 1;
+    free_block *free_one = ptr;
+    uint32_t bin = block->bin;
+
+    if (bin < MALLOC_BIN_COUNT) {
+        thread_cache *cache = __thread_cache();
+        if (cache && cache->counts[bin] < MALLOC_TCACHE_MAX) {
+            free_one->next = cache->bins[bin];
+            cache->bins[bin] = free_one;
+            cache->counts[bin]++;
+            return;
+        }
+    }
+
+    mutex_lock(&heap_lock);
+    free_block **list = bin < MALLOC_BIN_COUNT ? &bins[bin] : &large_blocks;
+    free_one->next = *list;
+    *list = free_one;
+    mutex_unlock(&heap_lock);
+}
+
+void *calloc(size_t count, size_t size) {
+    if (size && count > (size_t)-1 / size) return 0;
+
+    void *ptr = malloc(count * size);
+    if (ptr) __zero(ptr, count * size);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    if (!size) {
+        free(ptr);
+        return 0;
+    }
+
+    block_header *block = (block_header *)ptr - 1;
+    if (block->size >= size) return ptr;
+
+    void *moved = malloc(size);
+    if (moved) {
+        __copy(moved, ptr, block->size);
+        free(ptr);
+    }
+    return moved;
+}
+
+void malloc_thread_exit(void) {
+    uint32_t owner = vdso_gettid() + 1;
+
+    for (int i = 0; i < MALLOC_TCACHE_SLOTS; i++) {
+        thread_cache *cache = &caches[i];
+        if (cache->owner != owner) continue;
+
+        mutex_lock(&heap_lock);
+        for (int bin = 0; bin < MALLOC_BIN_COUNT; bin++) {
+            while (cache->bins[bin]) {
+                free_block *free_one = cache->bins[bin];
+                cache->bins[bin] = free_one->next;
+                free_one->next = bins[bin];
+                bins[bin] = free_one;
+            }
+            cache->counts[bin] = 0;
+        }
+        mutex_unlock(&heap_lock);
+
+        __atomic_store_n(&cache->owner, 0, __ATOMIC_RELEASE);
+        return;
+    }
+}
@@ -0,0 +1,30 @@
+// malloc.h
+// User-space allocator built on sbrk. Most calls never leave user space.
+
+#include <stdint.h>
+#include <stddef.h>
+#include "syscall_spec.h"
+
+// blocks up to 2048 bytes (header included) come from power of 2 size class
+// bins, and each thread keeps a small cache of free blocks per bin that it
+// can use without locking. larger blocks are first fit from one list. memory
+// is taken from the kernel one whole sbrk chunk at a time, so no block can
+// be larger than that.
+#define MALLOC_MIN_SHIFT 4
+#define MALLOC_BIN_COUNT 8
+#define MALLOC_ARENA_SIZE SBRK_CHUNK_SIZE
+
+// threads that can have a cache at once. the rest always take the lock
+#define MALLOC_TCACHE_SLOTS 8
+// free blocks a thread keeps per bin, and how many it moves at a time
+#define MALLOC_TCACHE_MAX 16
+#define MALLOC_TCACHE_BATCH 8
+
+void *malloc(size_t size);
+void free(void *ptr);
+void *calloc(size_t count, size_t size);
+void *realloc(void *ptr, size_t size);
+
+// hands the calling thread's cache back. call before a thread returns, or
+// its cached blocks and cache slot stay with its TID
+void malloc_thread_exit(void);
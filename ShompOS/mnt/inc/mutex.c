@@ -0,0 +1,55 @@
+/*
+~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles  -m32 -fPIE -c -o mutex.o mutex.c
+*/
+
+#include "syscalls.h"
+#include "mutex.h"
+
+void mutex_lock(mutex_t *m) {
+    // fast path: 0 -> 1 without entering the kernel
+    uint32_t c = __sync_val_compare_and_swap(&m->state, 0, 1);
+    if (c == 0) return;
+
+    // contended: mark the lock as having sleepers, then sleep until the
+    // holder hands it back. whoever wins the exchange from 0 owns the lock.
+    if (c != 2) c = __sync_lock_test_and_set(&m->state, 2);
+    while (c != 0) {
+        futex_wait(&m->state, 2, 0);
+        c = __sync_lock_test_and_set(&m->state, 2);
+    }
+}
+
+int32_t mutex_trylock(mutex_t *m) {
+    return __sync_val_compare_and_swap(&m->state, 0, 1) == 0 ? 0 : -1;
+}
+
+void mutex_unlock(mutex_t *m) {
+    // 1 -> 0 means nobody was waiting, so there is nobody to wake
+    if (__sync_fetch_and_sub(&m->state, 1) != 1) {
+        m->state = 0;
+        futex_wake(&m->state, 1);
+    }
+}
+
+void cond_wait(cond_t *c, mutex_t *m) {
+    uint32_t seq = c->seq;
+
+    mutex_unlock(m);
+    // returns at once if a signal already bumped seq after we read it
+    futex_wait(&c->seq, seq, 0);
+
+    // relock as contended: other waiters may have been woken with us
+    while (__sync_lock_test_and_set(&m->state, 2) != 0) {
+        futex_wait(&m->state, 2, 0);
+    }
+}
+
+void cond_signal(cond_t *c) {
+    __sync_fetch_and_add(&c->seq, 1);
+    futex_wake(&c->seq, 1);
+}
+
+void cond_broadcast(cond_t *c) {
+    __sync_fetch_and_add(&c->seq, 1);
+    futex_wake(&c->seq, (uint32_t)-1);
+}
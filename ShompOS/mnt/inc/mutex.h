@@ -0,0 +1,26 @@
+// mutex.h
+// User-space mutexes and condition variables built on the futex syscall.
+// Uncontended lock and unlock never leave user space.
+
+#include <stdint.h>
+
+// state: 0 = unlocked, 1 = locked, 2 = locked and someone may be sleeping
+typedef struct {
+    volatile uint32_t state;
+} mutex_t;
+
+// seq is bumped on every signal so a waiter can tell it missed one
+typedef struct {
+    volatile uint32_t seq;
+} cond_t;
+
+#define MUTEX_INITIALIZER {0}
+#define COND_INITIALIZER {0}
+
+void mutex_lock(mutex_t *m);
+int32_t mutex_trylock(mutex_t *m);
+void mutex_unlock(mutex_t *m);
+
+void cond_wait(cond_t *c, mutex_t *m);
+void cond_signal(cond_t *c);
+void cond_broadcast(cond_t *c);
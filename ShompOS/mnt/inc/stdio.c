@@ -0,0 +1,383 @@
+/*
+~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles  -m32 -fPIE -c -o stdio.o stdio.c
+*/
+
+#include "syscalls.h"
+#include "stdio.h"
+
+static FILE streams[3 + FOPEN_MAX] = {
+    { .fd = 0, .mode = _IOLBF, .in_use = 1 },
+    { .fd = 1, .mode = _IOLBF, .in_use = 1 },
+    { .fd = 2, .mode = _IONBF, .in_use = 1 },
+};
+
+FILE *stdin = &streams[0];
+FILE *stdout = &streams[1];
+FILE *stderr = &streams[2];
+
+// ----- output -----
+
+// purpose: writes out everything buffered in a stream
+// returns: 0, or EOF if the write failed
+static int __flush_writes(FILE *stream) {
+    uint32_t done = 0;
+    while (done < stream->write_len) {
+        int32_t n = write(stream->fd, stream->buf + done, stream->write_len - done);
+        if (n <= 0) {
+            stream->error = 1;
+            stream->write_len = 0;
+            return EOF;
+        }
+        done += n;
+    }
+    stream->write_len = 0;
+    return 0;
+}
+
+// purpose: adds bytes to a stream, writing the buffer out whenever it fills,
+//          and for line buffered streams, after the last newline
+// returns: 0, or EOF if a write failed
+static int __put(FILE *stream, const char *data, size_t len) {
+    // anything read ahead is stale once we write
+    stream->read_pos = stream->read_len = 0;
+
+    if (stream->mode == _IONBF) {
+        if (__flush_writes(stream)) return EOF;
+        while (len) {
+            int32_t n = write(stream->fd, data, len);
+            if (n <= 0) {
+                stream->error = 1;
+                return EOF;
+            }
+            data += n;
+            len -= n;
+        }
+        return 0;
+    }
+
+    int newline = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (stream->write_len == BUFSIZ && __flush_writes(stream)) return EOF;
+        stream->buf[stream->write_len++] = data[i];
+        if (data[i] == '\n') newline = 1;
+    }
+
+    if (newline && stream->mode == _IOLBF) return __flush_writes(stream);
+    return 0;
+}
+
+int fflush(FILE *stream) {
+    if (!stream) {
+        int result = 0;
+        for (int i = 0; i < 3 + FOPEN_MAX; i++) {
+            if (streams[i].in_use && fflush(&streams[i])) result = EOF;
+        }
+        return result;
+    }
+    return __flush_writes(stream);
+}
+
+// only the mode can change: buffers are always the stream's own
+int setvbuf(FILE *stream, char *buf, int mode, size_t size) {
+    (void)buf;
+    (void)size;
+    if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) return -1;
+    if (fflush(stream)) return -1;
+    stream->mode = mode;
+    return 0;
+}
+
+int fputc(int c, FILE *stream) {
+    char ch = (char)c;
+    return __put(stream, &ch, 1) ? EOF : (unsigned char)ch;
+}
+
+int putchar(int c) {
+    return fputc(c, stdout);
+}
+
+int fputs(const char *s, FILE *stream) {
+    size_t len = 0;
+    while (s[len]) len++;
+    return __put(stream, s, len) ? EOF : 0;
+}
+
+int puts(const char *s) {
+    if (fputs(s, stdout)) return EOF;
+    return fputc('\n', stdout) == EOF ? EOF : 0;
+}
+
+size_t fwrite(const void *ptr, size_t size, size_t count, FILE *stream) {
+    if (!size || !count) return 0;
+    return __put(stream, ptr, size * count) ? 0 : count;
+}
+
+// ----- input -----
+
+// purpose: refills a stream's buffer from its fd
+// returns: the number of bytes now buffered, 0 at the end of input
+static uint32_t __fill(FILE *stream) {
+    // a prompt on stdout should be visible before we wait for an answer
+    if (stream == stdin) fflush(stdout);
+    if (__flush_writes(stream)) return 0;
+
+    int32_t n = read(stream->fd, stream->buf, BUFSIZ);
+    stream->read_pos = 0;
+    stream->read_len = n > 0 ? n : 0;
+    if (n == 0) stream->eof = 1;
+    if (n < 0) stream->error = 1;
+    return stream->read_len;
+}
+
+int fgetc(FILE *stream) {
+    if (stream->read_pos == stream->read_len && !__fill(stream)) return EOF;
+    return (unsigned char)stream->buf[stream->read_pos++];
+}
+
+int getchar(void) {
+    return fgetc(stdin);
+}
+
+char *fgets(char *s, int size, FILE *stream) {
+    int i = 0;
+    while (i < size - 1) {
+        int c = fgetc(stream);
+        if (c == EOF) break;
+        s[i++] = (char)c;
+        if (c == '\n') break;
+    }
+    if (i == 0 || size <= 0) return 0;
+    s[i] = '\0';
+    return s;
+}
+
+size_t fread(void *ptr, size_t size, size_t count, FILE *stream) {
+    char *out = ptr;
+    size_t total = size * count;
+    size_t done = 0;
+    while (done < total) {
+        if (stream->read_pos == stream->read_len && !__fill(stream)) break;
+        uint32_t chunk = stream->read_len - stream->read_pos;
+        if (chunk > total - done) chunk = total - done;
+        for (uint32_t i = 0; i < chunk; i++) out[done + i] = stream->buf[stream->read_pos + i];
+        stream->read_pos += chunk;
+        done += chunk;
+    }
+    return size ? done / size : 0;
+}
+
+int feof(FILE *stream) {
+    return stream->eof;
+}
+
+int ferror(FILE *stream) {
+    return stream->error;
+}
+
+// ----- files -----
+
+FILE *fopen(const char *path, const char *mode) {
+    int flags;
+    switch (mode[0]) {
+        case 'r': flags = mode[1] == '+' ? O_RDWR : O_RDONLY; break;
+        case 'w': flags = (mode[1] == '+' ? O_RDWR : O_WRONLY) | O_TRUNC; break;
+        case 'a': flags = (mode[1] == '+' ? O_RDWR : O_WRONLY) | O_APPEND; break;
+        default: return 0;
+    }
+
+    for (int i = 3; i < 3 + FOPEN_MAX; i++) {
+        FILE *stream = &streams[i];
+        if (stream->in_use) continue;
+
+        int fd = open(path, flags, 0);
+        if (fd < 0) return 0;
+
+        stream->fd = fd;
+        stream->mode = _IOFBF;
+        stream->in_use = 1;
+        stream->error = stream->eof = 0;
+        stream->write_len = stream->read_pos = stream->read_len = 0;
+        return stream;
+    }
+    return 0;
+}
+
+int fclose(FILE *stream) {
+    int result = fflush(stream);
+    if (close(stream->fd)) result = EOF;
+    stream->in_use = 0;
+    return result;
+}
+
+// ----- formatting -----
+// the formatter writes through a sink, so the same code fills a FILE or a
+// caller's string.
+
+typedef struct {
+    FILE *stream;           // NULL when writing to a string
+    char *s;
+    size_t size;
+    int count;              // characters produced, written or not
+} sink;
+
+static void __emit(sink *out, const char *data, size_t len) {
+    if (out->stream) {
+        __put(out->stream, data, len);
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            if (out->count + i + 1 < out->size) out->s[out->count + i] = data[i];
+        }
+    }
+    out->count += len;
+}
+
+static void __pad(sink *out, char c, int n) {
+    while (n-- > 0) __emit(out, &c, 1);
+}
+
+// purpose: emits one field, padded out to width
+static void __field(sink *out, const char *data, int len, int width, int left, char pad) {
+    // zero padding goes after a sign
+    if (pad == '0' && len && data[0] == '-') {
+        __emit(out, data, 1);
+        data++;
+        len--;
+        width--;
+    }
+    if (!left) __pad(out, pad, width - len);
+    __emit(out, data, len);
+    if (left) __pad(out, ' ', width - len);
+}
+
+static int __format(sink *out, const char *format, va_list args) {
+    static const char lower[] = "0123456789abcdef";
+    static const char upper[] = "0123456789ABCDEF";
+
+    for (const char *p = format; *p; p++) {
+        if (*p != '%') {
+            const char *run = p;
+            while (p[1] && p[1] != '%') p++;
+            __emit(out, run, p - run + 1);
+            continue;
+        }
+
+        int left = 0, width = 0, precision = -1;
+        char pad = ' ';
+        p++;
+        for (; *p == '-' || *p == '0'; p++) {
+            if (*p == '-') left = 1;
+            else pad = '0';
+        }
+        if (left) pad = ' ';
+        for (; *p >= '0' && *p <= '9'; p++) width = width * 10 + (*p - '0');
+        if (*p == '.') {
+            precision = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++) precision = precision * 10 + (*p - '0');
+        }
+        while (*p == 'l') p++;
+
+        char digits[12];
+        int len = 0;
+        char *end = digits + sizeof(digits);
+        uint32_t value;
+        uint32_t base = 10;
+        const char *set = lower;
+
+        switch (*p) {
+            case 'd':
+            case 'i': {
+                int32_t n = va_arg(args, int32_t);
+                value = n < 0 ? -(uint32_t)n : (uint32_t)n;
+                do { *--end = lower[value % 10]; value /= 10; } while (value);
+                if (n < 0) *--end = '-';
+                len = digits + sizeof(digits) - end;
+                __field(out, end, len, width, left, pad);
+                break;
+            }
+            case 'p':
+                __emit(out, "0x", 2);
+                width -= 2;
+                pad = '0';
+                width = width < 8 ? 8 : width;
+                // fall through
+            case 'X':
+                if (*p == 'X') set = upper;
+                // fall through
+            case 'x':
+                base = 16;
+                // fall through
+            case 'u':
+                value = *p == 'p' ? (uint32_t)va_arg(args, void *) : va_arg(args, uint32_t);
+                do { *--end = set[value % base]; value /= base; } while (value);
+                len = digits + sizeof(digits) - end;
+                __field(out, end, len, width, left, pad);
+                break;
+            case 'c':
+                digits[0] = (char)va_arg(args, int);
+                __field(out, digits, 1, width, left, ' ');
+                break;
+            case 's': {
+                const char *s = va_arg(args, const char *);
+                if (!s) s = "(null)";
+                while (s[len] && (precision < 0 || len < precision)) len++;
+                __field(out, s, len, width, left, ' ');
+                break;
+            }
+            case '%':
+                __emit(out, "%", 1);
+                break;
+            default:
+                // unknown conversion: print it as it was written
+                __emit(out, "%", 1);
+                if (!*p) return out->count;
+                __emit(out, p, 1);
+                break;
+        }
+    }
+    return out->count;
+}
+
+int vfprintf(FILE *stream, const char *format, va_list args) {
+    sink out = { .stream = stream };
+
+    // an unbuffered stream still gets each printf in one write
+    int mode = stream->mode;
+    if (mode == _IONBF) stream->mode = _IOFBF;
+    __format(&out, format, args);
+    if (mode == _IONBF) {
+        stream->mode = mode;
+        if (__flush_writes(stream)) return EOF;
+    }
+    return out.count;
+}
+
+int fprintf(FILE *stream, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = vfprintf(stream, format, args);
+    va_end(args);
+    return count;
+}
+
+int printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = vfprintf(stdout, format, args);
+    va_end(args);
+    return count;
+}
+
+int vsnprintf(char *s, size_t size, const char *format, va_list args) {
+    sink out = { .s = s, .size = size };
+    __format(&out, format, args);
+    if (size) s[(size_t)out.count < size ? (size_t)out.count : size - 1] = '\0';
+    return out.count;
+}
+
+int snprintf(char *s, size_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = vsnprintf(s, size, format, args);
+    va_end(args);
+    return count;
+}
@@ -0,0 +1,65 @@
+// stdio.h
+// Buffered streams over the read and write syscalls.
+// stdout is line buffered, stderr unbuffered and files fully buffered, so a
+// screenful of printf() output costs a handful of syscalls instead of one
+// per call. Streams are not locked: share one between threads with care.
+// exit(), or returning from main through _start, flushes every open stream.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#define BUFSIZ 512
+#define EOF (-1)
+// streams fopen() can have open at once, on top of the standard three
+#define FOPEN_MAX 8
+
+// buffering modes for setvbuf()
+#define _IOFBF 0
+#define _IOLBF 1
+#define _IONBF 2
+
+typedef struct _FILE {
+    int fd;
+    int mode;               // _IOFBF, _IOLBF or _IONBF
+    int in_use;
+    int error;
+    int eof;
+    uint32_t write_len;     // bytes waiting to be written
+    uint32_t read_pos;      // next unread byte
+    uint32_t read_len;      // bytes read in
+    char buf[BUFSIZ];
+} FILE;
+
+extern FILE *stdin;
+extern FILE *stdout;
+extern FILE *stderr;
+
+// ramfs can't create files, so "w" and "a" need one that already exists.
+// "w" empties it first
+FILE *fopen(const char *path, const char *mode);
+int fclose(FILE *stream);
+int fflush(FILE *stream);
+int setvbuf(FILE *stream, char *buf, int mode, size_t size);
+
+int fputc(int c, FILE *stream);
+int putchar(int c);
+int fputs(const char *s, FILE *stream);
+int puts(const char *s);
+size_t fwrite(const void *ptr, size_t size, size_t count, FILE *stream);
+
+int fgetc(FILE *stream);
+int getchar(void);
+char *fgets(char *s, int size, FILE *stream);
+size_t fread(void *ptr, size_t size, size_t count, FILE *stream);
+
+int feof(FILE *stream);
+int ferror(FILE *stream);
+
+// supports %d %i %u %x %X %p %c %s %%, the - and 0 flags, a width and a
+// precision for %s. l is accepted and ignored: int and long are the same
+int printf(const char *format, ...);
+int fprintf(FILE *stream, const char *format, ...);
+int vfprintf(FILE *stream, const char *format, va_list args);
+int snprintf(char *s, size_t size, const char *format, ...);
+int vsnprintf(char *s, size_t size, const char *format, va_list args);
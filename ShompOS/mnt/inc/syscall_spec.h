@@ -0,0 +1,92 @@
+// syscall_spec.h
+// The syscall ABI: one line per syscall, shared by the kernel and programs
+// Cedarville University 2024-25 OSDev Team
+
+// the kernel builds sys_table from this list, and syscalls.c builds a stub
+// for each entry, so adding a syscall means adding a line here and a
+// syscall_<name> handler in src/syscalls/syscalls.c. numbers follow Linux
+// i386 where Linux has the same call, and start at 360 for our own.
+//
+// SYSCALL(number, name, return type, argument count, (parameters), (arguments))
+//
+// arguments are passed in ebx, ecx, edx, esi, edi, ebp and the result comes
+// back in eax. unknown numbers return -1.
+
+#ifndef SYSCALL_SPEC_H
+#define SYSCALL_SPEC_H
+
+// slots in sys_table. must stay above the largest number below.
+#define SYSCALL_TABLE_SIZE 384
+
+// the most memory sbrk can hand out in one run. each run is one chunk of
+// the kernel heap, see src/process/brk.h, so ask for this much at a time to
+// use a whole chunk.
+#define SBRK_CHUNK_SIZE 32751
+
+#define SYSCALL_LIST(SYSCALL) \
+    /* processes. exit ends every thread in the process. spawn starts the */ \
+    /* program at path (relative to the root) with a NULL terminated argv */ \
+    /* and waitpid collects what its main returned or passed to exit. */ \
+    SYSCALL(1,   exit,          void,     1, (int32_t status), (status)) \
+    SYSCALL(7,   waitpid,       int32_t,  3, (uint32_t pid, int *status, int options), (pid, status, options)) \
+    SYSCALL(20,  getpid,        uint32_t, 0, (void), ()) \
+    SYSCALL(158, yield,         int32_t,  0, (void), ()) \
+    SYSCALL(368, spawn,         int32_t,  2, (const char *path, char *const argv[]), (path, argv)) \
+    SYSCALL(369, msleep,        int32_t,  1, (uint32_t ms), (ms)) \
+    /* time and ids without a trap. returns the page vdso.h reads. */ \
+    SYSCALL(372, vdso_address,  const vdso_data *, 0, (void), ()) \
+    /* files. fds 0-2 may be redirected to pipes by the shell. */ \
+    SYSCALL(3,   read,          int32_t,  3, (uint32_t fd, char *buf, uint32_t count), (fd, buf, count)) \
+    SYSCALL(4,   write,         int32_t,  3, (uint32_t fd, const char *buf, uint32_t count), (fd, buf, count)) \
+    SYSCALL(5,   open,          int32_t,  3, (const char *filename, int flags, uint32_t mode), (filename, flags, mode)) \
+    SYSCALL(6,   close,         int32_t,  1, (uint32_t fd), (fd)) \
+    SYSCALL(19,  lseek,         int32_t,  3, (uint32_t fd, int32_t offset, int whence), (fd, offset, whence)) \
+    /* mapping files. PROT_READ shares the file's data if the range lies */ \
+    /* in one of its 4KB chunks, PROT_WRITE or a larger range gives a */ \
+    /* private copy. a file can't be deleted while shared. */ \
+    SYSCALL(373, mmap,          void *,   4, (uint32_t fd, uint32_t offset, uint32_t len, int prot), (fd, offset, len, prot)) \
+    SYSCALL(91,  munmap,        int32_t,  2, (void *addr, uint32_t len), (addr, len)) \
+    /* program break, for malloc.h. sbrk returns the start of the new */ \
+    /* memory, or (void *)-1. memory from two calls is only contiguous if */ \
+    /* it fits in the same chunk, see src/process/brk.h. before the first */ \
+    /* growing sbrk there is no break, and sbrk(0) fails. */ \
+    SYSCALL(45,  brk,           int32_t,  1, (void *addr), (addr)) \
+    SYSCALL(374, sbrk,          void *,   1, (int32_t increment), (increment)) \
+    /* batched I/O. see io_ring.h */ \
+    SYSCALL(370, io_ring_setup, io_ring *, 0, (void), ()) \
+    SYSCALL(371, io_ring_enter, int32_t,  0, (void), ()) \
+    /* threads. a thread runs fn(arg) on its own stack and shares */ \
+    /* everything else with its process. getpid is the process, gettid */ \
+    /* the thread. */ \
+    SYSCALL(224, gettid,        uint32_t, 0, (void), ()) \
+    SYSCALL(366, thread_create, int32_t,  2, (thread_fn fn, void *arg), (fn, arg)) \
+    SYSCALL(367, thread_join,   int32_t,  2, (uint32_t tid, int *status), (tid, status)) \
+    /* futex. see futex_wait and futex_wake in syscalls.h */ \
+    SYSCALL(240, futex,         int32_t,  4, (volatile uint32_t *addr, int op, uint32_t val, uint32_t timeout_ticks), (addr, op, val, timeout_ticks)) \
+    /* deadline scheduling. guarantees runtime ticks of CPU within */ \
+    /* deadline ticks of the start of every period. pid 0 is the caller, */ \
+    /* runtime 0 turns it off. fails if the CPU is already too heavily */ \
+    /* reserved. */ \
+    SYSCALL(351, sched_setattr, int32_t,  4, (uint32_t pid, uint32_t runtime, uint32_t deadline, uint32_t period), (pid, runtime, deadline, period)) \
+    /* shared memory. a region has the same address in every process that */ \
+    /* attaches it, so buffers can be handed over without copying. it is */ \
+    /* freed once nobody is attached and its owner unlinked it or exited. */ \
+    /* shm_transfer takes the TGID of a process attached to the region. */ \
+    SYSCALL(360, shm_create,    int32_t,  2, (const char *name, uint32_t size), (name, size)) \
+    SYSCALL(361, shm_attach,    void *,   1, (int32_t id), (id)) \
+    SYSCALL(362, shm_detach,    int32_t,  1, (int32_t id), (id)) \
+    SYSCALL(363, shm_transfer,  int32_t,  2, (int32_t id, uint32_t new_owner), (id, new_owner)) \
+    SYSCALL(364, shm_notify,    uint32_t, 1, (int32_t id), (id)) \
+    SYSCALL(365, shm_wait,      uint32_t, 2, (int32_t id, uint32_t seen_sequence), (id, seen_sequence)) \
+    SYSCALL(375, shm_unlink,    int32_t,  1, (int32_t id), (id))
+
+#ifndef __ASSEMBLER__
+
+// SYS_<name> is the number of each syscall
+#define __SYSCALL_NUMBER(num, name, ...) SYS_##name = num,
+enum { SYSCALL_LIST(__SYSCALL_NUMBER) };
+#undef __SYSCALL_NUMBER
+
+#endif // __ASSEMBLER__
+
+#endif // SYSCALL_SPEC_H
@@ -3,30 +3,50 @@
 ~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles  -m32 -fPIE -c -o assembly.o syscalls.S
 cd ../home
 ~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles  -m32 -fPIE -c -o test_syscalls.o test_syscalls.c
-~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles -nostdlib -m32 -Wl,-emain -o test_syscalls test_syscalls.o ../inc/syscalls.o ../inc/assembly.o
+~/opt/cross/bin/i686-elf-gcc -ffreestanding -nostartfiles -nostdlib -m32 -o test_syscalls test_syscalls.o ../inc/syscalls.o ../inc/assembly.o
 */
 
 
 #include "syscalls.h"
-
-extern uint32_t do_syscall(const uint32_t eax, const uint32_t ebx, const uint32_t ecx, const uint32_t edx, const uint32_t esi, const uint32_t edi, const uint32_t ebp);
-
-void exit(int32_t error_code) {
-    do_syscall(1, error_code, 0, 0, 0, 0, 0);
+#include "stdio.h"
+
+// stdio.o is optional. when a program doesn't link it, this is NULL
+int fflush(FILE *stream) __attribute__((weak));
+int main(int argc, char *argv[]);
+
+// pads a stub's arguments out to the six registers, as plain words
+#define SYSCALL_ARG(x) ((uint32_t)(x))
+#define SYSCALL_ARGS0() 0, 0, 0, 0, 0, 0
+#define SYSCALL_ARGS1(a) SYSCALL_ARG(a), 0, 0, 0, 0, 0
+#define SYSCALL_ARGS2(a, b) SYSCALL_ARG(a), SYSCALL_ARG(b), 0, 0, 0, 0
+#define SYSCALL_ARGS3(a, b, c) SYSCALL_ARG(a), SYSCALL_ARG(b), SYSCALL_ARG(c), 0, 0, 0
+#define SYSCALL_ARGS4(a, b, c, d) SYSCALL_ARG(a), SYSCALL_ARG(b), SYSCALL_ARG(c), SYSCALL_ARG(d), 0, 0
+
+#define SYSCALL(num, name, ret, nargs, params, args) \
+    ret name params { \
+        return (ret)do_syscall(num, SYSCALL_ARGS##nargs args); \
+    }
+// the exit stub is named _exit, so exit() below can flush stdio first
+#define exit _exit
+SYSCALL_LIST(SYSCALL)
+#undef exit
+#undef SYSCALL
+
+void exit(int32_t status) {
+    if (fflush) fflush(NULL);
+    _exit(status);
 }
 
-uint32_t read(uint32_t fd, char *buf, uint32_t count) {
-    do_syscall(3, fd, buf, count, 0, 0, 0);
+// entry point of programs linked without -emain. the kernel calls it as
+// main(argc, argv), and it leaves through exit() so buffered output is kept.
+void _start(int argc, char *argv[]) {
+    exit(main(argc, argv));
 }
 
-uint32_t write(uint32_t fd, const char *buf, uint32_t count) {
-    do_syscall(4, fd, buf, count, 0, 0, 0);
+int32_t futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout_ticks) {
+    return futex(addr, FUTEX_WAIT, expected, timeout_ticks);
 }
 
-uint32_t open(const char *filename, int flags, uint32_t mode) {
-    do_syscall(5, filename, flags, mode, 0, 0, 0);
+uint32_t futex_wake(volatile uint32_t *addr, uint32_t count) {
+    return futex(addr, FUTEX_WAKE, count, 0);
 }
-
-uint32_t close(uint32_t fd) {
-    do_syscall(6, fd, 0, 0, 0, 0, 0);
-}
\ No newline at end of file
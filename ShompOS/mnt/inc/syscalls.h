@@ -1,10 +1,40 @@
+#include <stdint.h>
 
+// a thread's start routine. what it returns is the thread's exit status.
+typedef int (*thread_fn)(void *arg);
 
-#include <stdint.h>
+#include "io_ring.h"
+#include "vdso.h"
+#include "syscall_spec.h"
+
+// one function per syscall, generated from syscall_spec.h
+#define SYSCALL(num, name, ret, nargs, params, args) ret name params;
+SYSCALL_LIST(SYSCALL)
+#undef SYSCALL
+
+// exit flushes every stdio stream before ending the process. _exit is the
+// bare syscall and drops whatever is still buffered.
+void _exit(int32_t status);
+
+// futex. futex_wait sleeps only if *addr still equals expected, and
+// futex_wake wakes up to count sleepers on addr. see mutex.h.
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+int32_t futex_wait(volatile uint32_t *addr, uint32_t expected, uint32_t timeout_ticks);
+uint32_t futex_wake(volatile uint32_t *addr, uint32_t count);
+
+// open flags. ramfs has no O_CREAT: only existing files can be opened
+#define O_RDONLY 0x0001
+#define O_WRONLY 0x0002
+#define O_RDWR   0x0003
+#define O_APPEND 0x0004
+#define O_TRUNC  0x0008   // empty the file first. fails while it is mapped
 
+// mmap protection. see syscall_spec.h
+#define PROT_READ  0x1
+#define PROT_WRITE 0x2
 
-void exit(int32_t error_code);
-uint32_t read(uint32_t fd, char *buf, uint32_t count);
-uint32_t write(uint32_t fd, const char *buf, uint32_t count);
-uint32_t open(const char *filename, int flags, uint32_t mode);
-uint32_t close(uint32_t fd);
\ No newline at end of file
+// raw syscall entry points. do_syscall uses int $0x80 and always works.
+// do_sysenter takes the faster SYSENTER path, which needs a CPU that has it.
+uint32_t do_syscall(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi, uint32_t edi, uint32_t ebp);
+uint32_t do_sysenter(uint32_t eax, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi, uint32_t edi, uint32_t ebp);
@@ -0,0 +1,105 @@
+// vdso.h
+// Kernel data page every program can read without a syscall
+// Cedarville University 2024-25 OSDev Team
+
+// the kernel keeps one vdso_data up to date from the clock interrupt and the
+// scheduler. vdso_address() returns where it is (the same address in every
+// process, as there is no paging) and the helpers below read it with a
+// seqlock: the kernel makes sequence odd while it writes, so a reader that
+// sees it change, or sees it odd, tries again. programs must not write it.
+
+#ifndef VDSO_H
+#define VDSO_H
+
+#include <stdint.h>
+
+typedef struct _vdso_data {
+    volatile uint32_t sequence;     // odd while the kernel is updating
+    uint32_t ticks;                 // clock ticks since boot
+    uint32_t ticks_per_second;
+    uint32_t uptime_ms;             // milliseconds since boot, as of the last tick
+    uint64_t tick_tsc;              // TSC at the last tick
+    uint32_t tick_cycles;           // TSC cycles the last tick took
+    uint32_t pid;                   // process on the CPU, the reader itself
+    uint32_t tid;                   // thread on the CPU, the reader itself
+} vdso_data;
+
+// a consistent copy of the clock fields
+typedef struct _vdso_time {
+    uint32_t ticks;
+    uint32_t uptime_ms;
+    uint64_t tick_tsc;
+    uint32_t tick_cycles;
+} vdso_time;
+
+const vdso_data *vdso_address(void);
+
+// returns: the data page, asking the kernel once per program
+static inline const vdso_data *vdso_page(void) {
+    static const vdso_data *page;
+    if (!page) page = vdso_address();
+    return page;
+}
+
+static inline uint32_t __vdso_read_begin(const vdso_data *data) {
+    uint32_t sequence;
+    while ((sequence = __atomic_load_n(&data->sequence, __ATOMIC_ACQUIRE)) & 1);
+    return sequence;
+}
+
+static inline int __vdso_read_retry(const vdso_data *data, uint32_t sequence) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return data->sequence != sequence;
+}
+
+// stores the clock fields in *time
+static inline void vdso_clock(vdso_time *time) {
+    const vdso_data *data = vdso_page();
+    uint32_t sequence;
+    do {
+        sequence = __vdso_read_begin(data);
+        time->ticks = data->ticks;
+        time->uptime_ms = data->uptime_ms;
+        time->tick_tsc = data->tick_tsc;
+        time->tick_cycles = data->tick_cycles;
+    } while (__vdso_read_retry(data, sequence));
+}
+
+// returns: milliseconds since boot, to the last tick
+static inline uint32_t vdso_uptime_ms(void) {
+    vdso_time time;
+    vdso_clock(&time);
+    return time.uptime_ms;
+}
+
+// returns: the TSC, for timestamps finer than a tick. compare with tick_tsc
+//          and tick_cycles from vdso_clock() to place it within a tick
+static inline uint64_t vdso_cycles(void) {
+    uint32_t low, high;
+    __asm__ volatile ("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// returns: the same as getpid(), without a syscall
+static inline uint32_t vdso_getpid(void) {
+    const vdso_data *data = vdso_page();
+    uint32_t sequence, pid;
+    do {
+        sequence = __vdso_read_begin(data);
+        pid = data->pid;
+    } while (__vdso_read_retry(data, sequence));
+    return pid;
+}
+
+// returns: the same as gettid(), without a syscall
+static inline uint32_t vdso_gettid(void) {
+    const vdso_data *data = vdso_page();
+    uint32_t sequence, tid;
+    do {
+        sequence = __vdso_read_begin(data);
+        tid = data->tid;
+    } while (__vdso_read_retry(data, sequence));
+    return tid;
+}
+
+#endif // VDSO_H
@@ -6,31 +6,100 @@
 #include <ramfs.h>
 #include <heap.h>
 #include <string.h>
+#include <boot.h>
 
 #define STACK_SIZE_DEFAULT 1000
 
-processID init_elf(ramfs_file_t* f) {
+// argc and argv, packed into the bottom of a new program's stack. the stack
+// grows down from the top, and the block goes away with the stack.
+typedef struct _elf_args {
+    int argc;
+    char* argv[];   // argc pointers and a NULL, followed by the strings
+} elf_args;
+
+typedef int (*elf_main)(int argc, char* argv[]);
+
+// purpose: first code a program runs. calls its entry point as
+//          main(argc, argv) and keeps what it returns as the exit status.
+//          returning from here lands in kill_process.
+static void __elf_trampoline() {
+    process_struct* proc = get_process(get_active_pid());
+    elf_args* args = proc->start_arg;
+    proc->exit_status = ((elf_main)proc->start_routine)(args->argc, args->argv);
+}
+
+// purpose: measures the block __pack_args() will build
+// argv: NULL terminated argument strings. may be NULL
+// argc: set to the number of arguments
+// returns: the size of the block in bytes, or 0 if it is too large
+static size_t __args_size(char* const argv[], int* argc) {
+    size_t size = sizeof(elf_args) + sizeof(char*);
+    *argc = 0;
+
+    for (; argv && argv[*argc]; (*argc)++) {
+        if (*argc == ELF_MAX_ARGS) return 0;
+        size += sizeof(char*) + strlen(argv[*argc]) + 1;
+    }
+
+    return size <= ELF_MAX_ARG_BYTES ? size : 0;
+}
+
+// purpose: copies argc and argv into a block so the caller's strings don't
+//          need to outlive the call
+// dest: __args_size() bytes
+static void __pack_args(elf_args* dest, char* const argv[], int argc) {
+    char* strings = (char*)&dest->argv[argc + 1];
+
+    dest->argc = argc;
+    for (int i = 0; i < argc; i++) {
+        size_t len = strlen(argv[i]) + 1;
+        memcpy(strings, argv[i], len);
+        dest->argv[i] = strings;
+        strings += len;
+    }
+    dest->argv[argc] = NULL;
+}
+
+// purpose: copies program header i out of f
+// returns: 0 on success, -1 if the file is too short to hold it
+static int __read_phdr(ramfs_file_t* f, const Elf32_Ehdr* ehdr, int i, Elf32_Phdr* phdr) {
+    size_t offset = ehdr->e_phoff + (size_t)i * ehdr->e_phentsize;
+    return ramfs_file_read(f, offset, phdr, sizeof(*phdr)) == sizeof(*phdr) ? 0 : -1;
+}
+
+processID init_elf(ramfs_file_t* f, char* const argv[]) {
+    int argc;
+    size_t args_size = __args_size(argv, &argc);
+    if (!args_size) {
+        return (processID)-1;
+    }
+
     int rc = is_readable(f);
     if (rc) {
-        return ELF_ERROR;
+        return (processID)-1;
     }
 
 
-    Elf32_Ehdr *elfHeader = (Elf32_Ehdr*)f->data;
+    // The file is stored in chunks, so headers are copied out rather than
+    // read in place
+    Elf32_Ehdr ehdr;
+    ramfs_file_read(f, 0, &ehdr, sizeof(ehdr));
+    Elf32_Ehdr *elfHeader = &ehdr;
 
-
-    Elf32_Phdr *pHeaders = (Elf32_Phdr*)(f->data + elfHeader->e_phoff);
     void *textSpace;
     uint32_t size = 0;
     Elf32_Addr min_vaddr = -1;
 
-    Elf32_Phdr *header = &pHeaders[0];
+    Elf32_Phdr phdr;
+    Elf32_Phdr *header = &phdr;
 
     // Read every program header to determine what the lowest virtual address
     // is and how much space is needed to be allocated
     for (int i = 0; i < elfHeader->e_phnum; i++) {
 
-        header = &pHeaders[i];
+        if (__read_phdr(f, elfHeader, i, header)) {
+            return (processID)-1;
+        }
 
         // If LOAD,
         if (header->p_type != PROGRAM_TYPE_LOAD && header->p_memsz > 0) {
@@ -55,12 +124,12 @@ processID init_elf(ramfs_file_t* f) {
     textSpace = allocate(size);
 
     if (!textSpace) {
-        return ELF_ERROR;
+        return (processID)-1;
     }
 
     for (int i = 0; i < elfHeader->e_phnum; i++) {
 
-        header = &pHeaders[i];
+        __read_phdr(f, elfHeader, i, header);
 
         // If LOAD,
         if (header->p_type != PROGRAM_TYPE_LOAD && header->p_memsz > 0) {
@@ -68,26 +137,48 @@ processID init_elf(ramfs_file_t* f) {
         }
 
         // Copy segment data from file
-        memcpy(textSpace, f->data + header->p_offset, header->p_filesz);
+        ramfs_file_read(f, header->p_offset, textSpace, header->p_filesz);
     
         // Zero out rest of segment
         memset(textSpace + header->p_filesz, '\0', header->p_memsz - header->p_filesz);
 
     }
 
-    // Create stack
-    void *stackSpace = allocate(STACK_SIZE_DEFAULT);
+    // Create stack, with room for the arguments at the bottom
+    void *stackSpace = allocate(STACK_SIZE_DEFAULT + args_size);
     if (!stackSpace) {
         free(textSpace);
-        return ELF_ERROR;
+        return (processID)-1;
     }
+    __pack_args(stackSpace, argv, argc);
+
+    uint32_t flags = save_and_disable_interrupts();
+    processID pid = init_process(&__elf_trampoline, stackSpace);
+    process_struct* proc = get_process(pid);
+    if (!proc) {
+        restore_interrupts(flags);
+        free(stackSpace);
+        free(textSpace);
+        return (processID)-1;
+    }
+
+    proc->entry_point = textSpace + elfHeader->e_entry - min_vaddr;
+    proc->start_routine = proc->entry_point;
+    proc->start_arg = stackSpace;
+    // the reaper frees the program image once the process exits
+    proc->image = textSpace;
+    restore_interrupts(flags);
 
-    return init_process(textSpace + elfHeader->e_entry - min_vaddr, stackSpace);
+    return pid;
 }
 
 
 int is_readable(ramfs_file_t* f) {
-    Elf32_Ehdr *elfHeader = (Elf32_Ehdr*)f->data;
+    Elf32_Ehdr ehdr;
+    if (ramfs_file_read(f, 0, &ehdr, sizeof(ehdr)) != sizeof(ehdr)) {
+        return NOT_ELF_FILE;
+    }
+    Elf32_Ehdr *elfHeader = &ehdr;
     if (elfHeader->e_ident[0] != '\x7F' ||
            elfHeader->e_ident[1] != 'E' ||
            elfHeader->e_ident[2] != 'L' ||
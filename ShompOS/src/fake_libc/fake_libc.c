@@ -13,3 +13,28 @@ inline bool is_head_of_list(list_header* node) {
 inline int max(int a, int b) {
 	return a >= b ? a : b;
 }
+
+// purpose: makes a list_header into an empty list (or a detached node) by
+//          pointing it at itself
+inline void init_list(list_header* head) {
+    head->next = head;
+    head->prev = head;
+}
+
+// purpose: appends a node to the end of a circular list
+// head: the list to append to
+// node: a detached node
+inline void list_add_tail(list_header* head, list_header* node) {
+    node->next = head;
+    node->prev = head->prev;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+// purpose: unlinks a node from whatever list it is in and leaves it detached
+// node: the node to remove
+inline void list_remove(list_header* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    init_list(node);
+}
@@ -0,0 +1,139 @@
+// ring_buffer.c
+// Lock-free fixed size ring buffers for passing items between interrupt
+// handlers and processes
+// Cedarville University 2024-25 OSDev Team
+
+#include <fake_libc/ring_buffer.h>
+#include <string.h>
+
+// acquire/release order the item copy against the index that publishes it.
+// on x86 both only stop the compiler from reordering; the CPU keeps stores
+// in order already.
+#define __ring_load(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define __ring_store(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+
+// purpose: sets up an empty single producer, single consumer ring
+// ring: the ring to initialize
+// storage: RING_STORAGE_SIZE(item_size, capacity) bytes owned by the caller
+// item_size: bytes per item
+// capacity: number of items. must be a power of 2
+void ring_init(ring_buffer* ring, void* storage, uint32_t item_size, uint32_t capacity) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->data = storage;
+    ring->item_size = item_size;
+    ring->mask = capacity - 1;
+}
+
+// purpose: adds an item. only one context may push to a ring.
+// item: item_size bytes to copy in
+// returns: false if the ring is full
+bool ring_push(ring_buffer* ring, const void* item) {
+    uint32_t tail = ring->tail;
+    if (tail - __ring_load(&ring->head) > ring->mask) return false;
+
+    memcpy(ring->data + (tail & ring->mask) * ring->item_size, item, ring->item_size);
+    __ring_store(&ring->tail, tail + 1);
+    return true;
+}
+
+// purpose: removes the oldest item. only one context may pop from a ring.
+// item: item_size bytes to copy out to
+// returns: false if the ring is empty
+bool ring_pop(ring_buffer* ring, void* item) {
+    uint32_t head = ring->head;
+    if (head == __ring_load(&ring->tail)) return false;
+
+    memcpy(item, ring->data + (head & ring->mask) * ring->item_size, ring->item_size);
+    __ring_store(&ring->head, head + 1);
+    return true;
+}
+
+// returns: true if there is nothing to pop
+bool ring_empty(ring_buffer* ring) {
+    return __ring_load(&ring->head) == __ring_load(&ring->tail);
+}
+
+// returns: the number of items waiting to be popped
+uint32_t ring_count(ring_buffer* ring) {
+    return __ring_load(&ring->tail) - __ring_load(&ring->head);
+}
+
+// purpose: finds the sequence number at the front of a slot
+static inline volatile uint32_t* __mpsc_sequence(mpsc_ring_buffer* ring, uint32_t index) {
+    return (volatile uint32_t*)(ring->slots + (index & ring->mask) * ring->slot_size);
+}
+
+// purpose: sets up an empty multiple producer, single consumer ring
+// ring: the ring to initialize
+// storage: MPSC_RING_STORAGE_SIZE(item_size, capacity) bytes owned by the caller
+// item_size: bytes per item
+// capacity: number of items. must be a power of 2
+void mpsc_ring_init(mpsc_ring_buffer* ring, void* storage, uint32_t item_size, uint32_t capacity) {
+    ring->head = 0;
+    ring->tail = 0;
+    ring->slots = storage;
+    ring->item_size = item_size;
+    ring->slot_size = MPSC_SLOT_SIZE(item_size);
+    ring->mask = capacity - 1;
+
+    // a slot is free for the producer that claims index i when its sequence
+    // is i, and ready for the consumer when it is i + 1
+    for (uint32_t i = 0; i < capacity; i++) {
+        *__mpsc_sequence(ring, i) = i;
+    }
+}
+
+// purpose: adds an item. safe to call from any number of processes and
+//          interrupt handlers at once, including an IRQ that interrupts
+//          another push.
+// item: item_size bytes to copy in
+// returns: false if the ring is full
+bool mpsc_ring_push(mpsc_ring_buffer* ring, const void* item) {
+    uint32_t tail = ring->tail;
+    volatile uint32_t* sequence;
+
+    while (1) {
+        sequence = __mpsc_sequence(ring, tail);
+        int32_t diff = (int32_t)(__ring_load(sequence) - tail);
+
+        if (diff == 0) {
+            // slot is free: try to claim it. on failure someone else did,
+            // so retry with the tail they left behind
+            uint32_t seen = __sync_val_compare_and_swap(&ring->tail, tail, tail + 1);
+            if (seen == tail) break;
+            tail = seen;
+        } else if (diff < 0) {
+            // the consumer hasn't freed this slot from the last lap yet
+            return false;
+        } else {
+            tail = ring->tail;
+        }
+    }
+
+    memcpy((uint8_t*)sequence + sizeof(uint32_t), item, ring->item_size);
+    __ring_store(sequence, tail + 1);
+    return true;
+}
+
+// purpose: removes the oldest item. only one context may pop from a ring.
+// item: item_size bytes to copy out to
+// returns: false if the ring is empty, or the oldest claimed slot is still
+//          being written
+bool mpsc_ring_pop(mpsc_ring_buffer* ring, void* item) {
+    uint32_t head = ring->head;
+    volatile uint32_t* sequence = __mpsc_sequence(ring, head);
+    if (__ring_load(sequence) != head + 1) return false;
+
+    memcpy(item, (uint8_t*)sequence + sizeof(uint32_t), ring->item_size);
+    // hand the slot back to producers one lap ahead
+    __ring_store(sequence, head + ring->mask + 1);
+    __ring_store(&ring->head, head + 1);
+    return true;
+}
+
+// returns: true if there is nothing ready to pop
+bool mpsc_ring_empty(mpsc_ring_buffer* ring) {
+    uint32_t head = __ring_load(&ring->head);
+    return __ring_load(__mpsc_sequence(ring, head)) != head + 1;
+}
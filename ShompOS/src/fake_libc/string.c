@@ -94,22 +94,14 @@ char *strdup(const char *s) {
 }
 
 int strncmp(const char *s1, const char *s2, size_t n) {
-    if (n == 0) return 0;
-
-    while (n-- > 0 && *s1 && *s2) {
-        if (*s1 != *s2) {
-            return (*(unsigned char *)s1 - *(unsigned char *)s2);
-        }
+    while (n > 0 && *s1 && *s1 == *s2) {
         s1++;
         s2++;
+        n--;
     }
 
-    if (n > 0) {
-        if (*s1) return 1;
-        if (*s2) return -1;
-    }
-
-    return 0;
+    if (n == 0) return 0;
+    return (*(unsigned char *)s1 - *(unsigned char *)s2);
 }
 
 char *strtok(char *str, const char *delim) {
@@ -0,0 +1,114 @@
+// mmap.c
+// Mapping ramfs file contents into processes
+// Cedarville University 2024-25 OSDev Team
+
+#include <mmap.h>
+#include <heap.h>
+#include <boot.h>
+#include <string.h>
+
+static mmap_region mmap_table[MAX_MMAP_REGIONS];
+
+// purpose: finds the process (thread group) the caller belongs to
+// returns: its TGID, or -1 if there is no active process
+static processID __mmap_owner() {
+    process_struct* proc = get_process(get_active_pid());
+    return proc ? proc->TGID : (processID)-1;
+}
+
+// purpose: drops a mapping. call with interrupts disabled.
+static void __mmap_release(mmap_region* region) {
+    if (region->file) region->file->map_count--;
+    else free(region->addr);
+    region->in_use = false;
+}
+
+// purpose: maps part of an open file into the calling process
+// fd: an open file. pipes and the terminal can't be mapped
+// offset: the first byte of the file to map
+// len: bytes to map. the range must lie inside the file
+// prot: PROT_READ shares the file's data, which the caller must not write.
+//       PROT_WRITE gives the caller its own copy to change as it likes.
+//       files are stored in 4KB chunks. the first PROT_READ mapping of a
+//       range that crosses one re-chunks the file into blocks of up to
+//       RAMFS_CHUNK_MAX, so files up to 32KB are always shared. a range
+//       that still crosses a chunk, or any range while the file already
+//       has other mappings into its old chunks, gets a private copy
+// returns: the address of the mapping, or NULL on failure
+void* mmap_file(int fd, size_t offset, size_t len, int prot) {
+    if (fd <= STDERR_FILENO || fd >= MAX_FDS || !fd_table[fd]) return NULL;
+    ramfs_file_t* file = fd_table[fd]->file;
+    if (!file || !len || offset > file->size || len > file->size - offset) return NULL;
+    if (!(prot & (PROT_READ | PROT_WRITE))) return NULL;
+
+    uint32_t flags = save_and_disable_interrupts();
+    mmap_region* region = NULL;
+    for (int i = 0; i < MAX_MMAP_REGIONS; i++) {
+        if (!mmap_table[i].in_use) {
+            region = &mmap_table[i];
+            break;
+        }
+    }
+
+    void* addr = NULL;
+    if (region) {
+        char* shared = NULL;
+        if (!(prot & PROT_WRITE)) {
+            shared = ramfs_file_span(file, offset, len);
+            if (!shared && !ramfs_file_coalesce(file)) shared = ramfs_file_span(file, offset, len);
+        }
+        if (shared) {
+            addr = shared;
+            file->map_count++;
+            region->file = file;
+        } else {
+            addr = allocate(len);
+            if (addr) ramfs_file_read(file, offset, addr, len);
+            region->file = NULL;
+        }
+    }
+
+    if (addr) {
+        region->addr = addr;
+        region->len = len;
+        region->owner = __mmap_owner();
+        region->in_use = true;
+    }
+
+    restore_interrupts(flags);
+    return addr;
+}
+
+// purpose: removes a mapping made by the calling process
+// addr: the address mmap_file() returned
+// len: the length it was given
+// returns: 0 on success, -1 if the caller has no such mapping
+int munmap_region(void* addr, size_t len) {
+    processID owner = __mmap_owner();
+    uint32_t flags = save_and_disable_interrupts();
+    int result = -1;
+
+    for (int i = 0; i < MAX_MMAP_REGIONS; i++) {
+        mmap_region* region = &mmap_table[i];
+        if (region->in_use && region->owner == owner && region->addr == addr && region->len == len) {
+            __mmap_release(region);
+            result = 0;
+            break;
+        }
+    }
+
+    restore_interrupts(flags);
+    return result;
+}
+
+// purpose: removes every mapping a process still has. called once it exits
+// owner: the TGID of the process
+void munmap_process(processID owner) {
+    uint32_t flags = save_and_disable_interrupts();
+    for (int i = 0; i < MAX_MMAP_REGIONS; i++) {
+        if (mmap_table[i].in_use && mmap_table[i].owner == owner) {
+            __mmap_release(&mmap_table[i]);
+        }
+    }
+    restore_interrupts(flags);
+}
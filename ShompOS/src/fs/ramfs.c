@@ -8,17 +8,236 @@
 //#include <stdio.h>
 #include <string.h>
 #include <kernel.h>
+#include <boot.h>
+
+// Hash a name with FNV-1a
+static uint32_t ramfs_hash(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// The name of a file or directory. Both keep it as their first member
+static const char *ramfs_entry_name(void *entry) {
+    return *(char **)entry;
+}
+
+// Find an entry by name. Returns NULL if there is none
+static void *ramfs_index_find(ramfs_index_t *index, const char *name, size_t len) {
+    if (!index->slots) return NULL;
+
+    uint32_t hash = ramfs_hash(name, len);
+    size_t mask = index->capacity - 1;
+    for (size_t i = hash & mask; index->slots[i].entry; i = (i + 1) & mask) {
+        ramfs_index_slot_t *slot = &index->slots[i];
+        if (slot->hash != hash || slot->entry == RAMFS_INDEX_DELETED) continue;
+
+        const char *entry_name = ramfs_entry_name(slot->entry);
+        if (strncmp(entry_name, name, len) == 0 && entry_name[len] == '\0') {
+            return slot->entry;
+        }
+    }
+    return NULL;
+}
+
+// Put an entry in the first free slot for its hash. There must be one
+static void ramfs_index_place(ramfs_index_slot_t *slots, size_t capacity, uint32_t hash, void *entry) {
+    size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    while (slots[i].entry && slots[i].entry != RAMFS_INDEX_DELETED) {
+        i = (i + 1) & mask;
+    }
+    slots[i].hash = hash;
+    slots[i].entry = entry;
+}
+
+// Rebuild the index with room for count live entries, dropping deleted
+// slots. Returns 0 on success, -1 if out of memory
+static int ramfs_index_resize(ramfs_index_t *index, size_t count) {
+    size_t capacity = RAMFS_INDEX_MIN;
+    while (capacity * 3 < (count + 1) * 4) capacity *= 2;
+
+    ramfs_index_slot_t *slots = allocate(capacity * sizeof(ramfs_index_slot_t));
+    if (!slots) return -1;
+    memset(slots, 0, capacity * sizeof(ramfs_index_slot_t));
+
+    size_t used = 0;
+    for (size_t i = 0; i < index->capacity; i++) {
+        void *entry = index->slots[i].entry;
+        if (entry && entry != RAMFS_INDEX_DELETED) {
+            ramfs_index_place(slots, capacity, index->slots[i].hash, entry);
+            used++;
+        }
+    }
+
+    if (index->slots) free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    index->used = used;
+    return 0;
+}
+
+// Add an entry. count is how many live entries the index holds already.
+// Returns 0 on success, -1 if out of memory
+static int ramfs_index_insert(ramfs_index_t *index, void *entry, size_t count) {
+    if ((index->used + 1) * 4 > index->capacity * 3) {
+        if (ramfs_index_resize(index, count + 1)) return -1;
+    }
+
+    const char *name = ramfs_entry_name(entry);
+    ramfs_index_place(index->slots, index->capacity, ramfs_hash(name, strlen(name)), entry);
+    index->used++;
+    return 0;
+}
+
+// Remove an entry, leaving a marker so later probes continue past it. Only
+// the slot for the entry's current name is removed: during a rename the
+// entry briefly has a second slot, under its new name, on the same chain
+static void ramfs_index_remove(ramfs_index_t *index, void *entry) {
+    if (!index->slots) return;
+
+    const char *name = ramfs_entry_name(entry);
+    uint32_t hash = ramfs_hash(name, strlen(name));
+    size_t mask = index->capacity - 1;
+    for (size_t i = hash & mask; index->slots[i].entry; i = (i + 1) & mask) {
+        if (index->slots[i].entry == entry && index->slots[i].hash == hash) {
+            index->slots[i].entry = RAMFS_INDEX_DELETED;
+            return;
+        }
+    }
+}
+
+// Find the file called name (len bytes, need not be NUL terminated) in dir
+ramfs_file_t *ramfs_lookup_file(ramfs_dir_t *dir, const char *name, size_t len) {
+    if (!dir || !name) return NULL;
+    return ramfs_index_find(&dir->file_index, name, len);
+}
+
+// Find the subdirectory called name (len bytes, need not be NUL terminated)
+ramfs_dir_t *ramfs_lookup_dir(ramfs_dir_t *dir, const char *name, size_t len) {
+    if (!dir || !name) return NULL;
+    return ramfs_index_find(&dir->subdir_index, name, len);
+}
+
+static ramfs_dentry_t dcache[RAMFS_DCACHE_SIZE];
+static uint32_t dcache_generation = 1;
+
+// Forget every cached path. Called whenever the tree changes
+void ramfs_dcache_invalidate() {
+    uint32_t flags = save_and_disable_interrupts();
+    if (++dcache_generation == 0) {
+        // Old entries could look current again after a wrap, so drop them
+        memset(dcache, 0, sizeof(dcache));
+        dcache_generation = 1;
+    }
+    restore_interrupts(flags);
+}
+
+// Hash a cache key. Returns 0 if the path is too long to cache
+static uint32_t ramfs_dcache_hash(ramfs_dir_t *base, const char *path, bool is_dir, size_t *len) {
+    *len = strlen(path);
+    if (*len >= RAMFS_DCACHE_PATH_MAX) return 0;
+    return ramfs_hash(path, *len) ^ ((uintptr_t)base >> 4) ^ is_dir;
+}
+
+// Look a path up in the cache. Returns true on a hit and stores what it
+// resolved to, possibly NULL, in *target
+static bool ramfs_dcache_get(ramfs_dir_t *base, const char *path, bool is_dir, void **target) {
+    size_t len;
+    uint32_t hash = ramfs_dcache_hash(base, path, is_dir, &len);
+    if (!hash) return false;
+
+    // Another process may be refilling the slot
+    uint32_t flags = save_and_disable_interrupts();
+    ramfs_dentry_t *entry = &dcache[hash & (RAMFS_DCACHE_SIZE - 1)];
+    bool hit = entry->generation == dcache_generation && entry->hash == hash &&
+               entry->base == base && entry->is_dir == is_dir &&
+               strcmp(entry->path, path) == 0;
+    if (hit) *target = entry->target;
+    restore_interrupts(flags);
+    return hit;
+}
+
+// Read the generation before walking a path, for ramfs_dcache_put
+static uint32_t ramfs_dcache_generation() {
+    return __atomic_load_n(&dcache_generation, __ATOMIC_ACQUIRE);
+}
+
+// Remember what a path resolved to. generation is what
+// ramfs_dcache_generation returned before the walk. If the tree changed
+// since, the result may already be stale, so it isn't kept
+static void ramfs_dcache_put(ramfs_dir_t *base, const char *path, bool is_dir, void *target, uint32_t generation) {
+    size_t len;
+    uint32_t hash = ramfs_dcache_hash(base, path, is_dir, &len);
+    if (!hash) return;
+
+    uint32_t flags = save_and_disable_interrupts();
+    if (generation != dcache_generation) {
+        restore_interrupts(flags);
+        return;
+    }
+    ramfs_dentry_t *entry = &dcache[hash & (RAMFS_DCACHE_SIZE - 1)];
+    entry->hash = hash;
+    entry->generation = dcache_generation;
+    entry->base = base;
+    entry->is_dir = is_dir;
+    entry->target = target;
+    memcpy(entry->path, path, len + 1);
+    restore_interrupts(flags);
+}
+
+// Resize a files, subdirs or chunks array, if needed, to suit count entries.
+// Doubling and halving at a quarter full means a run of creates or deletes
+// copies each entry a constant number of times on average. Returns the
+// array to use from now on, or NULL if it had to grow and couldn't. Entries
+// past the old count are left uninitialized
+static void *ramfs_array_fit(void *array, size_t *capacity, size_t count) {
+    size_t new_capacity = *capacity;
+    if (count > new_capacity) {
+        while (count > new_capacity) {
+            new_capacity = new_capacity ? new_capacity * 2 : RAMFS_ARRAY_MIN;
+        }
+    } else if (new_capacity > RAMFS_ARRAY_MIN && count <= new_capacity / 4) {
+        new_capacity /= 2;
+    }
+    if (new_capacity == *capacity) return array;
+
+    void *new_array = allocate(new_capacity * sizeof(void *));
+    if (!new_array) {
+        // Not shrinking costs nothing but memory
+        return count > *capacity ? NULL : array;
+    }
+
+    if (array) {
+        size_t keep = count < *capacity ? count : *capacity;
+        memcpy(new_array, array, keep * sizeof(void *));
+        free(array);
+    }
+    *capacity = new_capacity;
+    return new_array;
+}
+
+// Set up an empty directory
+static void ramfs_init_dir(ramfs_dir_t *dir, ramfs_dir_t *parent) {
+    dir->parent = parent;
+    dir->files = NULL;
+    dir->file_count = 0;
+    dir->file_capacity = 0;
+    dir->subdirs = NULL;
+    dir->subdir_count = 0;
+    dir->subdir_capacity = 0;
+    dir->file_index = (ramfs_index_t){ NULL, 0, 0 };
+    dir->subdir_index = (ramfs_index_t){ NULL, 0, 0 };
+}
 
 // create the root directory
 ramfs_dir_t *ramfs_create_root() {
     ramfs_dir_t *root = allocate(sizeof(ramfs_dir_t));
     if (!root) return NULL;
     root->name = strdup("/");
-    root->parent = NULL;
-    root->files = NULL;
-    root->file_count = 0;
-    root->subdirs = NULL;
-    root->subdir_count = 0;
+    ramfs_init_dir(root, NULL);
     return root;
 }
 
@@ -32,34 +251,181 @@ ramfs_dir_t *ramfs_create_dir(ramfs_dir_t *parent, const char *name) {
 
     // Initialize the directory
     new_dir->name = strdup(name);
-    new_dir->parent = parent;
-    new_dir->files = NULL;
-    new_dir->file_count = 0;
-    new_dir->subdirs = NULL;
-    new_dir->subdir_count = 0;
-
-    // Expand parent's subdirs array
-    ramfs_dir_t **new_subdirs = allocate((parent->subdir_count + 1) * sizeof(ramfs_dir_t*));
-    if (!new_subdirs) {
+    ramfs_init_dir(new_dir, parent);
+
+    // Make room in parent's subdirs array
+    ramfs_dir_t **subdirs = ramfs_array_fit(parent->subdirs, &parent->subdir_capacity,
+                                            parent->subdir_count + 1);
+    if (subdirs) parent->subdirs = subdirs;
+    if (!subdirs || ramfs_index_insert(&parent->subdir_index, new_dir, parent->subdir_count)) {
+        free(new_dir->name);
         void *dir_ptr = new_dir;
         free(dir_ptr);
         return NULL;
     }
 
-    // Copy existing subdirs if any
-    if (parent->subdirs) {
-        memcpy(new_subdirs, parent->subdirs, parent->subdir_count * sizeof(ramfs_dir_t*));
-        void *old_subdirs = parent->subdirs;
-        free(old_subdirs);
-    }
-
     // Add new directory
-    parent->subdirs = new_subdirs;
     parent->subdirs[parent->subdir_count++] = new_dir;
 
+    ramfs_dcache_invalidate();
     return new_dir;
 }
 
+// Add a file to a directory's array and index. Returns 0 on success, -1 if
+// out of memory, leaving the directory as it was
+static int ramfs_link_file(ramfs_dir_t *dir, ramfs_file_t *file) {
+    ramfs_file_t **files = ramfs_array_fit(dir->files, &dir->file_capacity, dir->file_count + 1);
+    if (!files) return -1;
+    dir->files = files;
+
+    if (ramfs_index_insert(&dir->file_index, file, dir->file_count)) return -1;
+
+    dir->files[dir->file_count++] = file;
+    return 0;
+}
+
+// Take a file out of a directory's array and index without freeing it
+static void ramfs_unlink_file(ramfs_dir_t *dir, ramfs_file_t *file) {
+    // Find its place in the array
+    size_t file_idx = 0;
+    while (dir->files[file_idx] != file) file_idx++;
+    ramfs_index_remove(&dir->file_index, file);
+
+    // If it's not the last file, shift remaining files left
+    if (file_idx < dir->file_count - 1) {
+        memmove(&dir->files[file_idx],
+                &dir->files[file_idx + 1],
+                (dir->file_count - file_idx - 1) * sizeof(ramfs_file_t*));
+    }
+
+    // Shrink the files array once it is mostly empty
+    dir->file_count--;
+    dir->files = ramfs_array_fit(dir->files, &dir->file_capacity, dir->file_count);
+}
+
+// Copy up to count bytes at offset out of a file, with holes reading as
+// zeros. Returns the number of bytes copied, less than count at the end
+size_t ramfs_file_read(ramfs_file_t *file, size_t offset, void *buf, size_t count) {
+    if (offset >= file->size) return 0;
+    if (count > file->size - offset) count = file->size - offset;
+
+    size_t done = 0;
+    while (done < count) {
+        size_t chunk = (offset + done) / file->chunk_size;
+        size_t start = (offset + done) % file->chunk_size;
+        size_t len = file->chunk_size - start;
+        if (len > count - done) len = count - done;
+
+        if (file->chunks[chunk]) {
+            memcpy((char *)buf + done, file->chunks[chunk] + start, len);
+        } else {
+            memset((char *)buf + done, 0, len);
+        }
+        done += len;
+    }
+    return done;
+}
+
+// Find len bytes at offset stored contiguously in one chunk. Returns NULL if
+// they cross a chunk boundary, lie in a hole or run past the end. See
+// ramfs_file_coalesce for making them contiguous
+char *ramfs_file_span(ramfs_file_t *file, size_t offset, size_t len) {
+    if (offset > file->size || len > file->size - offset) return NULL;
+
+    size_t chunk = offset / file->chunk_size;
+    size_t start = offset % file->chunk_size;
+    if (len > file->chunk_size - start || chunk >= file->chunk_count) return NULL;
+    return file->chunks[chunk] ? file->chunks[chunk] + start : NULL;
+}
+
+// Copy count bytes into a file at offset, growing it and filling in holes
+// as needed. Only the chunks written to are allocated, so writing past the
+// end leaves a hole instead of zeros. Returns the number of bytes written,
+// short only if out of memory
+static size_t ramfs_file_write(ramfs_file_t *file, size_t offset, const void *buf, size_t count) {
+    if (!count) return 0;
+
+    // Extend the chunk array, with holes, to cover the new end
+    size_t chunks_needed = (offset + count + file->chunk_size - 1) / file->chunk_size;
+    if (chunks_needed > file->chunk_count) {
+        char **chunks = ramfs_array_fit(file->chunks, &file->chunk_capacity, chunks_needed);
+        if (!chunks) return 0;
+        file->chunks = chunks;
+        while (file->chunk_count < chunks_needed) {
+            file->chunks[file->chunk_count++] = NULL;
+        }
+    }
+
+    size_t done = 0;
+    while (done < count) {
+        size_t chunk = (offset + done) / file->chunk_size;
+        size_t start = (offset + done) % file->chunk_size;
+        size_t len = file->chunk_size - start;
+        if (len > count - done) len = count - done;
+
+        if (!file->chunks[chunk]) {
+            // Zeroed, so the parts not written yet read like a hole
+            file->chunks[chunk] = allocate(file->chunk_size);
+            if (!file->chunks[chunk]) break;
+            memset(file->chunks[chunk], 0, file->chunk_size);
+        }
+        memcpy(file->chunks[chunk] + start, (const char *)buf + done, len);
+        done += len;
+    }
+
+    if (offset + done > file->size) file->size = offset + done;
+    return done;
+}
+
+// Free a file's contents
+static void ramfs_file_free_chunks(ramfs_file_t *file) {
+    for (size_t i = 0; i < file->chunk_count; i++) {
+        if (file->chunks[i]) free(file->chunks[i]);
+    }
+    if (file->chunks) free(file->chunks);
+    file->chunks = NULL;
+    file->chunk_count = 0;
+    file->chunk_capacity = 0;
+    file->chunk_size = RAMFS_CHUNK_SIZE;
+}
+
+// Move a file into chunks of the smallest heap block that holds all of it,
+// or RAMFS_CHUNK_MAX if none does, so mmap can share any range that fits in
+// one. Holes are filled in. Refused while mapped, since mappings point into
+// the old chunks. Returns 0 on success, -1 if nothing changed
+int ramfs_file_coalesce(ramfs_file_t *file) {
+    if (file->map_count) return -1;
+
+    size_t chunk_size = RAMFS_CHUNK_SIZE;
+    while (chunk_size < file->size && chunk_size < RAMFS_CHUNK_MAX) {
+        chunk_size = 2 * (chunk_size + sizeof(block_header)) - sizeof(block_header);
+    }
+    if (chunk_size == file->chunk_size) return -1;
+
+    size_t count = (file->size + chunk_size - 1) / chunk_size;
+    size_t capacity = 0;
+    char **chunks = ramfs_array_fit(NULL, &capacity, count);
+    if (!chunks) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        chunks[i] = allocate(chunk_size);
+        if (!chunks[i]) {
+            while (i--) free(chunks[i]);
+            free(chunks);
+            return -1;
+        }
+        memset(chunks[i], 0, chunk_size);
+        ramfs_file_read(file, i * chunk_size, chunks[i], chunk_size);
+    }
+
+    ramfs_file_free_chunks(file);
+    file->chunks = chunks;
+    file->chunk_count = count;
+    file->chunk_capacity = capacity;
+    file->chunk_size = chunk_size;
+    return 0;
+}
+
 // create a file
 ramfs_file_t *ramfs_create_file(ramfs_dir_t *dir, const char *name, const char *data, size_t size) {
     if (!dir || !name || !data) return NULL;
@@ -73,129 +439,162 @@ ramfs_file_t *ramfs_create_file(ramfs_dir_t *dir, const char *name, const char *
         return NULL;
     }
 
-    new_file->data = (size == 0) ? allocate(1) : allocate(size);
-    if (!new_file->data) {
-        free(new_file->name);
-        free(new_file);
-        return NULL;
-    }
+    new_file->chunks = NULL;
+    new_file->chunk_count = 0;
+    new_file->chunk_capacity = 0;
+    new_file->chunk_size = RAMFS_CHUNK_SIZE;
+    new_file->size = 0;
+    new_file->map_count = 0;
 
-    memcpy(new_file->data, data, size);
-    new_file->size = size;
-
-    ramfs_file_t **new_files = allocate((dir->file_count + 1) * sizeof(ramfs_file_t*));
-    if (!new_files) {
-        free(new_file->data);
+    if (ramfs_file_write(new_file, 0, data, size) != size || ramfs_link_file(dir, new_file)) {
+        ramfs_file_free_chunks(new_file);
         free(new_file->name);
         free(new_file);
         return NULL;
     }
 
-    if (dir->files) {
-        memcpy(new_files, dir->files, dir->file_count * sizeof(ramfs_file_t*));
-        free(dir->files);
-    }
-
-    dir->files = new_files;
-    dir->files[dir->file_count++] = new_file;
-
+    ramfs_dcache_invalidate();
     return new_file;
 }
 
 
 
-// Delete a file from a directory
-void ramfs_delete_file(ramfs_dir_t *dir, const char *name) {
-    if (!dir || !name || !dir->files || dir->file_count == 0) return;
+// Delete a file from a directory. Returns 0 on success, -1 on failure
+int ramfs_delete_file(ramfs_dir_t *dir, const char *name) {
+    if (!dir || !name || !dir->files || dir->file_count == 0) return -1;
 
-    // Find the file index
-    size_t file_idx = (size_t)-1;
-    for (size_t i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, name) == 0) {
-            file_idx = i;
-            break;
-        }
-    }
+    ramfs_file_t *file = ramfs_lookup_file(dir, name, strlen(name));
+    if (!file) return -1;
 
-    // If file not found, return
-    if (file_idx == (size_t)-1) return;
+    // A program still has its data mapped, so keep it
+    if (file->map_count) return -1;
+
+    ramfs_unlink_file(dir, file);
+    ramfs_dcache_invalidate();
 
     // Free the file's resources
-    void *name_ptr = dir->files[file_idx]->name;
-    void *data_ptr = dir->files[file_idx]->data;
-    void *file_ptr = dir->files[file_idx];
+    ramfs_file_free_chunks(file);
+    void *name_ptr = file->name;
+    void *file_ptr = file;
     free(name_ptr);
-    free(data_ptr);
     free(file_ptr);
+    return 0;
+}
 
-    // If it's not the last file, shift remaining files left
-    if (file_idx < dir->file_count - 1) {
-        memmove(&dir->files[file_idx],
-                &dir->files[file_idx + 1],
-                (dir->file_count - file_idx - 1) * sizeof(ramfs_file_t*));
-    }
+// Paths are walked in place as (name, length) slices, so lookups never
+// allocate and any number of processes can be walking at once
+
+// Get the next name in a path, skipping repeated slashes. Returns its
+// length, 0 once end is reached, and moves *cursor past it
+static size_t ramfs_path_next(const char **cursor, const char *end, const char **name) {
+    const char *c = *cursor;
+    while (c < end && *c == '/') c++;
+    *name = c;
+    while (c < end && *c != '/') c++;
+    *cursor = c;
+    return c - *name;
+}
 
-    // Shrink the files array if this wasn't the only file
-    if (dir->file_count > 1) {
-        ramfs_file_t **new_files = allocate((dir->file_count - 1) * sizeof(ramfs_file_t*));
-        if (new_files) {
-            memcpy(new_files, dir->files, (dir->file_count - 1) * sizeof(ramfs_file_t*));
-            void *old_files = dir->files;
-            free(old_files);
-            dir->files = new_files;
+// Follow the first len bytes of path to a directory. Absolute paths start at
+// the top of base's tree, anything else at base. "." and ".." work as usual,
+// and ".." at the top stays there
+static ramfs_dir_t *ramfs_walk_dir(ramfs_dir_t *base, const char *path, size_t len) {
+    ramfs_dir_t *current = base;
+    if (len && *path == '/') {
+        while (current->parent) current = current->parent;
+    }
+
+    const char *cursor = path;
+    const char *end = path + len;
+    const char *name;
+    size_t name_len;
+    while ((name_len = ramfs_path_next(&cursor, end, &name))) {
+        if (name_len == 1 && name[0] == '.') continue;
+        if (name_len == 2 && name[0] == '.' && name[1] == '.') {
+            if (current->parent) current = current->parent;
+            continue;
         }
-    } else {
-        // If it was the only file, just free the array
-        void *files_ptr = dir->files;
-        free(files_ptr);
-        dir->files = NULL;
+        current = ramfs_lookup_dir(current, name, name_len);
+        if (!current) return NULL;
     }
-
-    dir->file_count--;
+    return current;
 }
 
-// Find a directory given a path
-ramfs_dir_t *ramfs_find_dir(ramfs_dir_t *root, const char *path) {
-    if (!root || !path) return NULL;
+// Find the directory a path's last name lives in. Everything before the last
+// slash names the directory. Returns NULL if it doesn't exist, otherwise
+// points *name at the last name
+static ramfs_dir_t *ramfs_walk_parent(ramfs_dir_t *base, const char *path, const char **name) {
+    *name = path;
+    for (const char *c = path; *c; c++) {
+        if (*c == '/') *name = c + 1;
+    }
+    return ramfs_walk_dir(base, path, *name - path);
+}
 
-    // Handle root directory case
-    if (strcmp(path, "/") == 0) return root;
+// Move and/or rename a file. Both paths are relative to root, and the new
+// one must not exist yet. Returns 0 on success, -1 on failure
+int ramfs_rename(ramfs_dir_t *root, const char *old_path, const char *new_path) {
+    if (!root || !old_path || !new_path) return -1;
+    if (ramfs_find_file(root, new_path)) return -1;
+
+    const char *old_name;
+    const char *new_name;
+    ramfs_dir_t *old_dir = ramfs_walk_parent(root, old_path, &old_name);
+    ramfs_dir_t *new_dir = ramfs_walk_parent(root, new_path, &new_name);
+    if (!old_dir || !new_dir || *new_name == '\0') return -1;
+
+    ramfs_file_t *file = ramfs_lookup_file(old_dir, old_name, strlen(old_name));
+    if (!file) return -1;
+
+    char *name = strdup(new_name);
+    if (!name) return -1;
+
+    // Link under the new name first, so running out of memory loses nothing.
+    // Unlinking finds the old index slot by the old name's hash
+    char *old_file_name = file->name;
+    file->name = name;
+    if (ramfs_link_file(new_dir, file)) {
+        file->name = old_file_name;
+        free(name);
+        return -1;
+    }
+    file->name = old_file_name;
+    ramfs_unlink_file(old_dir, file);
+    file->name = name;
 
-    // Make a copy of path that we can modify
-    char *path_copy = strdup(path);
-    if (!path_copy) return NULL;
+    free(old_file_name);
+    ramfs_dcache_invalidate();
+    return 0;
+}
 
-    // Start at root
-    ramfs_dir_t *current = root;
+// Find a directory given a path, relative to root unless it starts with a
+// slash
+ramfs_dir_t *ramfs_find_dir(ramfs_dir_t *root, const char *path) {
+    if (!root || !path) return NULL;
 
-    // Skip leading slash if present
-    char *token = strtok(path_copy, "/");
+    void *cached;
+    if (ramfs_dcache_get(root, path, true, &cached)) return cached;
 
-    // Traverse the path
-    while (token) {
-        // Look for directory with matching name
-        ramfs_dir_t *found = NULL;
-        for (size_t i = 0; i < current->subdir_count; i++) {
-            if (strcmp(current->subdirs[i]->name, token) == 0) {
-                found = current->subdirs[i];
-                break;
-            }
-        }
+    uint32_t generation = ramfs_dcache_generation();
+    ramfs_dir_t *dir = ramfs_walk_dir(root, path, strlen(path));
+    ramfs_dcache_put(root, path, true, dir, generation);
+    return dir;
+}
 
-        // If directory not found, clean up and return NULL
-        if (!found) {
-            void *path_ptr = path_copy;
-            free(path_ptr);
-            return NULL;
-        }
+// Find a file given a path. Everything before the last slash names the
+// directory, relative to root
+ramfs_file_t *ramfs_find_file(ramfs_dir_t *root, const char *path) {
+    if (!root || !path || *path == '\0') return NULL;
 
-        current = found;
-        token = strtok(NULL, "/");
-    }
+    void *cached;
+    if (ramfs_dcache_get(root, path, false, &cached)) return cached;
 
-    void *path_ptr = path_copy;
-    free(path_ptr);
-    return current;
+    uint32_t generation = ramfs_dcache_generation();
+    const char *name;
+    ramfs_dir_t *dir = ramfs_walk_parent(root, path, &name);
+    ramfs_file_t *file = dir ? ramfs_lookup_file(dir, name, strlen(name)) : NULL;
+    ramfs_dcache_put(root, path, false, file, generation);
+    return file;
 }
 
 // Initialize the filesystem. Returns the root directory
@@ -227,55 +626,8 @@ int ramfs_init_fd_system(void) {
     return 0;
 }
 
-int ramfs_open(ramfs_dir_t *root, const char *path, int flags) {
-    if (!root || !path || *path == '\0') {
-        return -1;
-    }
-
-    // Handle special files
-    if (strcmp(path, "/dev/stdin") == 0) return 0;
-    if (strcmp(path, "/dev/stdout") == 0) return 1;
-    if (strcmp(path, "/dev/stderr") == 0) return 2;
-
-    // Copy path to safely manipulate it
-    char *path_copy = strdup(path);
-    if (!path_copy) {
-        return -1;
-    }
-
-    // Extract filename and directory path
-    char *last_slash = strchr(path_copy, '/');
-    ramfs_dir_t *dir = root;
-    char *filename = path_copy;
-
-    if (last_slash) {
-        *last_slash = '\0';  // Split into directory and filename
-        filename = last_slash + 1;
-
-        if (strlen(path_copy) > 0) {
-            dir = ramfs_find_dir(root, path_copy);
-            if (!dir) {
-                free(path_copy);
-                return -1;
-            }
-        }
-    }
-
-    // Locate the file in the directory
-    ramfs_file_t *file = NULL;
-    for (size_t i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, filename) == 0) {
-            file = dir->files[i];
-            break;
-        }
-    }
-
-    if (!file) {
-        free(path_copy);
-        return -1;
-    }
-
-    // Find an available file descriptor
+// Find a free slot in the fd table and fill it in. Returns -1 if full.
+static int ramfs_alloc_fd(ramfs_file_t *file, ramfs_pipe_t *pipe, int flags) {
     int fd = -1;
     for (int i = 0; i < MAX_FDS; i++) {
         if (fd_table[i] == NULL) {
@@ -285,29 +637,108 @@ int ramfs_open(ramfs_dir_t *root, const char *path, int flags) {
     }
 
     if (fd == -1) {
-        free(path_copy);
         return -1;
     }
 
-    // Allocate file descriptor entry
     ramfs_fd_t *fd_entry = allocate(sizeof(ramfs_fd_t));
     if (!fd_entry) {
-        free(path_copy);
         return -1;
     }
 
     fd_entry->fd = fd;
     fd_entry->file = file;
+    fd_entry->pipe = pipe;
     fd_entry->position = 0;
     fd_entry->flags = flags;
 
     fd_table[fd] = fd_entry;
     fd_count++;
 
-    free(path_copy);
     return fd;
 }
 
+int ramfs_open(ramfs_dir_t *root, const char *path, int flags) {
+    if (!root || !path || *path == '\0') {
+        return -1;
+    }
+
+    // Handle special files
+    if (strcmp(path, "/dev/stdin") == 0) return 0;
+    if (strcmp(path, "/dev/stdout") == 0) return 1;
+    if (strcmp(path, "/dev/stderr") == 0) return 2;
+
+    // Resolve the path, usually straight from the path cache
+    ramfs_file_t *file = ramfs_find_file(root, path);
+    if (!file) {
+        return -1;
+    }
+
+    // Empty the file if asked to. Mapped chunks can't be freed, so refuse
+    if ((flags & O_TRUNC) && (flags & O_WRONLY)) {
+        if (file->map_count) return -1;
+        ramfs_file_free_chunks(file);
+        file->size = 0;
+    }
+
+    return ramfs_alloc_fd(file, NULL, flags);
+}
+
+
+// Read up to count bytes from a pipe. Blocks while the pipe is empty and
+// a write end is still open. Returns 0 at end of file.
+static ssize_t ramfs_pipe_read(ramfs_pipe_t *pipe, void *buf, size_t count) {
+    uint32_t flags = save_and_disable_interrupts();
+
+    while (pipe->tail == pipe->head) {
+        if (pipe->writers == 0 || wait_on_queue(&pipe->read_waiters)) {
+            restore_interrupts(flags);
+            return 0;
+        }
+    }
+
+    size_t available = pipe->tail - pipe->head;
+    size_t bytes_to_read = (count > available) ? available : count;
+    for (size_t i = 0; i < bytes_to_read; i++) {
+        ((char *)buf)[i] = pipe->buffer[(pipe->head + i) % PIPE_BUFFER_SIZE];
+    }
+    pipe->head += bytes_to_read;
+
+    wake_queue(&pipe->write_waiters, (uint32_t)-1);
+    restore_interrupts(flags);
+    return bytes_to_read;
+}
+
+// Write count bytes to a pipe, blocking whenever it is full. Returns the
+// number of bytes written, or -1 if there are no readers left.
+static ssize_t ramfs_pipe_write(ramfs_pipe_t *pipe, const void *buf, size_t count) {
+    uint32_t flags = save_and_disable_interrupts();
+    size_t written = 0;
+
+    while (written < count) {
+        if (pipe->readers == 0) {
+            written = written ? written : (size_t)-1;
+            break;
+        }
+
+        size_t space = PIPE_BUFFER_SIZE - (pipe->tail - pipe->head);
+        if (space == 0) {
+            if (wait_on_queue(&pipe->write_waiters)) break;
+            continue;
+        }
+
+        size_t chunk = (count - written > space) ? space : count - written;
+        for (size_t i = 0; i < chunk; i++) {
+            pipe->buffer[(pipe->tail + i) % PIPE_BUFFER_SIZE] = ((const char *)buf)[written + i];
+        }
+        pipe->tail += chunk;
+        written += chunk;
+
+        wake_queue(&pipe->read_waiters, (uint32_t)-1);
+    }
+
+    restore_interrupts(flags);
+    return written;
+}
 
 // Read from a file using a file descriptor
 ssize_t ramfs_read(int fd, void *buf, size_t count) {
@@ -325,15 +756,17 @@ ssize_t ramfs_read(int fd, void *buf, size_t count) {
         return -1; // Not readable
     }
 
+    if (fd_entry->pipe) {
+        return ramfs_pipe_read(fd_entry->pipe, buf, count);
+    }
+
     if (fd_entry->file == NULL) {
         return -1; // No file associated
     }
 
-    size_t available = fd_entry->file->size - fd_entry->position;
-    size_t bytes_to_read = (count > available) ? available : count;
-    memcpy((char*)buf, fd_entry->file->data + fd_entry->position, bytes_to_read);
-    fd_entry->position += bytes_to_read;
-    return bytes_to_read;
+    size_t bytes_read = ramfs_file_read(fd_entry->file, fd_entry->position, buf, count);
+    fd_entry->position += bytes_read;
+    return bytes_read;
 }
 
 
@@ -344,8 +777,8 @@ ssize_t ramfs_write(int fd, const void *buf, size_t count) {
     }
 
     if (fd == STDOUT_FILENO || fd == STDERR_FILENO) {
-        // Simulate writing to terminal
-        terminal_writestring((const char *)buf);
+        // Draw exactly count bytes; buf need not be NUL terminated
+        terminal_write((const char *)buf, count);
         return count;
     }
 
@@ -355,6 +788,10 @@ ssize_t ramfs_write(int fd, const void *buf, size_t count) {
         return -1; // Not writable
     }
 
+    if (fd_entry->pipe) {
+        return ramfs_pipe_write(fd_entry->pipe, buf, count);
+    }
+
     if (fd_entry->file == NULL) {
         return -1; // No file associated
     }
@@ -364,29 +801,12 @@ ssize_t ramfs_write(int fd, const void *buf, size_t count) {
         fd_entry->position = fd_entry->file->size;
     }
 
-    size_t new_size = fd_entry->position + count;
-
-    if (new_size > fd_entry->file->size) {
-        // Resize file data buffer (manual realloc)
-        char *new_data = allocate(new_size);
-        if (!new_data) return -1;
-
-        // Copy old data into new buffer
-        if (fd_entry->file->data) {
-            memcpy(new_data, fd_entry->file->data, fd_entry->file->size);
-            void *old_data = fd_entry->file->data;
-            free(old_data);
-        }
+    // Appends only ever allocate new chunks, never copy old ones
+    size_t written = ramfs_file_write(fd_entry->file, fd_entry->position, buf, count);
+    if (written == 0 && count > 0) return -1;
+    fd_entry->position += written;
 
-        fd_entry->file->data = new_data;
-        fd_entry->file->size = new_size;
-    }
-
-    // Write new data
-    memcpy(fd_entry->file->data + fd_entry->position, buf, count);
-    fd_entry->position += count;
-
-    return count;
+    return written;
 }
 
 
@@ -399,6 +819,9 @@ off_t ramfs_seek(int fd, off_t offset, int origin) {
     ramfs_fd_t *fd_entry = fd_table[fd];
     ramfs_file_t *file = fd_entry->file;
 
+    // Pipes and the terminal have no position
+    if (!file) return -1;
+
     // Calculate new position based on origin
     off_t new_position = 0;
 
@@ -432,8 +855,26 @@ int ramfs_close(int fd) {
     }
 
     ramfs_fd_t *fd_entry = fd_table[fd];
+
+    // Drop this end of the pipe and let the other side see EOF or EPIPE
+    ramfs_pipe_t *pipe = fd_entry->pipe;
+    if (pipe) {
+        uint32_t flags = save_and_disable_interrupts();
+        if (fd_entry->flags & O_WRONLY) {
+            pipe->writers--;
+            wake_queue(&pipe->read_waiters, (uint32_t)-1);
+        } else {
+            pipe->readers--;
+            wake_queue(&pipe->write_waiters, (uint32_t)-1);
+        }
+        if (pipe->readers == 0 && pipe->writers == 0) {
+            free(pipe);
+        }
+        restore_interrupts(flags);
+    }
+
     void *fd_ptr = fd_entry;
-    free(&fd_ptr);
+    free(fd_ptr);
 
     fd_table[fd] = NULL;
     fd_count--;
@@ -441,6 +882,40 @@ int ramfs_close(int fd) {
     return 0;
 }
 
+// Create a pipe. fds[0] becomes the read end and fds[1] the write end.
+// Returns 0 on success, -1 on failure.
+int ramfs_pipe(int fds[2]) {
+    if (!fds) return -1;
+
+    ramfs_pipe_t *pipe = allocate(sizeof(ramfs_pipe_t));
+    if (!pipe) return -1;
+
+    pipe->head = 0;
+    pipe->tail = 0;
+    pipe->readers = 1;
+    pipe->writers = 1;
+    init_wait_queue(&pipe->read_waiters);
+    init_wait_queue(&pipe->write_waiters);
+
+    fds[0] = ramfs_alloc_fd(NULL, pipe, O_RDONLY);
+    if (fds[0] == -1) {
+        free(pipe);
+        return -1;
+    }
+
+    fds[1] = ramfs_alloc_fd(NULL, pipe, O_WRONLY);
+    if (fds[1] == -1) {
+        void *fd_ptr = fd_table[fds[0]];
+        free(fd_ptr);
+        fd_table[fds[0]] = NULL;
+        fd_count--;
+        free(pipe);
+        return -1;
+    }
+
+    return 0;
+}
+
 
 int init_stdio(ramfs_dir_t *root) {
     // Create special files for stdin, stdout, stderr with size 0
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <ramfs_executables.h>
 #include <kernel.h>
+#include <elf.h>
 
 void ramfs_pwd(ramfs_dir_t *dir) {
     if (!dir) return;
@@ -48,13 +49,11 @@ void ramfs_mkdir(ramfs_dir_t *dir, const char *dirname) {
     if (!dir || !dirname) return;
 
     // Check if directory already exists
-    for (size_t i = 0; i < dir->subdir_count; i++) {
-        if (strcmp(dir->subdirs[i]->name, dirname) == 0) {
-            terminal_writestring("Directory already exists: ");
-            terminal_writestring(dirname);
-            terminal_writestring("\n");
-            return;
-        }
+    if (ramfs_lookup_dir(dir, dirname, strlen(dirname))) {
+        terminal_writestring("Directory already exists: ");
+        terminal_writestring(dirname);
+        terminal_writestring("\n");
+        return;
     }
 
     // Create directory
@@ -75,27 +74,41 @@ void ramfs_rm(ramfs_dir_t *dir, const char *filename) {
     if (!dir || !filename) return;
 
     // Find the file
-    bool found = false;
-    for (size_t i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, filename) == 0) {
-            found = true;
-            break;
-        }
-    }
-
-    if (!found) {
+    if (!ramfs_lookup_file(dir, filename, strlen(filename))) {
         terminal_writestring("File not found: ");
         terminal_writestring(filename);
         terminal_writestring("\n");
         return;
     }
 
-    ramfs_delete_file(dir, filename);
+    if (ramfs_delete_file(dir, filename)) {
+        terminal_writestring("File is in use: ");
+        terminal_writestring(filename);
+        terminal_writestring("\n");
+        return;
+    }
     terminal_writestring("Removed file: ");
     terminal_writestring(filename);
     terminal_writestring("\n");
 }
 
+// Paths are relative to dir
+void ramfs_mv(ramfs_dir_t *dir, const char *old_path, const char *new_path) {
+    if (!dir || !old_path || !new_path) return;
+
+    if (ramfs_rename(dir, old_path, new_path)) {
+        terminal_writestring("Failed to move: ");
+        terminal_writestring(old_path);
+        terminal_writestring("\n");
+        return;
+    }
+    terminal_writestring("Moved file: ");
+    terminal_writestring(old_path);
+    terminal_writestring(" -> ");
+    terminal_writestring(new_path);
+    terminal_writestring("\n");
+}
+
 void ramfs_ls(ramfs_dir_t *dir) {
     if (!dir) return;
 
@@ -126,16 +139,20 @@ void ramfs_cat(ramfs_dir_t *dir, const char *filename) {
     while (*filename == ' ') filename++;
 
     // Find the file
-    ramfs_file_t* file = NULL;
-    for (size_t i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, filename) == 0) {
-            file = dir->files[i];
-            break;
-        }
-    }
+    ramfs_file_t* file = ramfs_find_file(dir, filename);
 
     if (file) {
-        terminal_writestring(file->data);
+        // Print a piece at a time, stopping at the first NUL as for a string
+        char buf[128];
+        size_t offset = 0;
+        size_t len;
+        while ((len = ramfs_file_read(file, offset, buf, sizeof(buf)))) {
+            size_t text = 0;
+            while (text < len && buf[text]) text++;
+            terminal_write(buf, text);
+            if (text < len) break;
+            offset += len;
+        }
         terminal_writestring("\n");
     } else {
         terminal_writestring("File not found: ");
@@ -157,11 +174,9 @@ void ramfs_touch(ramfs_dir_t *dir, const char *filename) {
     }
 
     // Check if file already exists
-    for (size_t i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, filename) == 0) {
-            terminal_writestring("File already exists\n");
-            return;
-        }
+    if (ramfs_lookup_file(dir, filename, strlen(filename))) {
+        terminal_writestring("File already exists\n");
+        return;
     }
 
     ramfs_file_t* file = ramfs_create_file(dir, filename, "", 1);
@@ -174,30 +189,63 @@ void ramfs_touch(ramfs_dir_t *dir, const char *filename) {
     }
 }
 
-ramfs_dir_t *ramfs_cd(ramfs_dir_t *root, const char *dir_name) {
-    return ramfs_find_dir(root, dir_name);
+// Paths starting with a slash are absolute, anything else is relative to dir
+ramfs_dir_t *ramfs_cd(ramfs_dir_t *dir, const char *dir_name) {
+    return ramfs_find_dir(dir, dir_name);
 }
 
-void ramfs_run(ramfs_dir_t *dir, const char *filename) {
-    if (!dir || !filename) return;
+// Get the next space separated word of a command line, ending it in place.
+// Unlike strtok this keeps no state of its own, so pipeline stages can split
+// their lines at the same time. Returns NULL at the end of the line, and
+// moves *cursor past the word
+static char *ramfs_next_arg(char **cursor) {
+    char *c = *cursor;
+    while (*c == ' ') c++;
+    if (!*c) return NULL;
+
+    char *arg = c;
+    while (*c && *c != ' ') c++;
+    if (*c) *c++ = '\0';
+    *cursor = c;
+    return arg;
+}
 
-    // Trim leading spaces
-    while (*filename == ' ') filename++;
+int ramfs_run(ramfs_dir_t *dir, const char *cmdline) {
+    if (!dir || !cmdline) return -1;
+
+    // Split the command line into the program name and its arguments
+    char *line = strdup(cmdline);
+    if (!line) return -1;
+    char *argv[ELF_MAX_ARGS + 1];
+    int argc = 0;
+    char *cursor = line;
+    for (char *arg; argc < ELF_MAX_ARGS && (arg = ramfs_next_arg(&cursor)); ) {
+        argv[argc++] = arg;
+    }
+    argv[argc] = NULL;
+
+    int result = -1;
+    const char *filename = argc ? argv[0] : "";
 
     // Find the file
-    ramfs_file_t* file = NULL;
-    for (size_t i = 0; i < dir->file_count; i++) {
-        if (strcmp(dir->files[i]->name, filename) == 0) {
-            file = dir->files[i];
-            break;
-        }
-    }
+    ramfs_file_t* file = ramfs_find_file(dir, filename);
 
     if (file) {
-        init_elf(file);
+        processID pid = init_elf(file, argv);
+        if (pid == (processID)-1) {
+            terminal_writestring("Not an executable: ");
+            terminal_writestring(filename);
+            terminal_writestring("\n");
+        } else {
+            result = pid;
+        }
     } else {
         terminal_writestring("File not found: ");
         terminal_writestring(filename);
         terminal_writestring("\n");
     }
+
+    void *line_ptr = line;
+    free(line_ptr);
+    return result;
 }
@@ -26,23 +26,31 @@
 /// IO Ports for PIT
 #define PIT_CHANNEL_0_DATA_PORT 0x40
 #define PIT_COMMAND_MODE_PORT 0x43
-// PIT will trigger an interrupt at a rate of 1193180 / divisor Hz
-// 0xFFFF results in around 18.3 Hz, the slowest possible with 16 bits
-#define PIT_DIVISOR 0xFFF
+// PIT_DIVISOR and the tick rate live in kernel/timer.h
 
 
 // ----- experimental attempt to run commands
 #define CMD_MAX_LEN 64
+// Scancodes the shell can fall behind by before keys are dropped (power of 2)
+#define SCANCODE_RING_SIZE 64
+// Null syscalls timed per entry path by the sysbench command
+#define SYSBENCH_ITERATIONS 10000
+#define SYSBENCH_SYSCALL 20 // getpid
 
 // ----- Includes -----
 #include <kernel/kernel.h>
 #include <kernel/boot.h>
+#include <kernel/timer.h>
+#include <kernel/vdso_page.h>
 
 #include <fake_libc/fake_libc.h> // Is this still relevant?
+#include <fake_libc/ring_buffer.h>
 
 #include <memory/heap.h>
 
 #include <process/process.h>
+#include <process/futex.h>
+#include <process/kthread.h>
 
 #include <IO/keyboard_map.h>
 #include <IO/keyboard_map_shift.h>
@@ -50,6 +58,7 @@
 #include <ramfs.h>
 #include <ramfs_executables.h>
 #include <elf.h>
+#include <syscalls/syscall_trace.h>
 
 
 // ----- Global variables -----
@@ -67,6 +76,19 @@ uint16_t* terminal_buffer;
 // --- input ---
 KEY_state special_key_state = {0,0,0,0,0};
 uint8_t control_key_flags = 0;
+// scancodes queued by the keyboard top half for the shell thread. ramfs_read
+// on stdin also polls the keyboard from process context, so there can be two
+// producers at once and the ring has to be the multi-producer kind.
+mpsc_ring_buffer scancode_ring;
+uint8_t scancode_storage[MPSC_RING_STORAGE_SIZE(sizeof(uint8_t), SCANCODE_RING_SIZE)];
+wait_queue keyboard_waiters;
+
+// --- interrupt latency ---
+IRQ_stats irq_stats[IRQ_STATS_COUNT];
+
+// --- syscalls ---
+// whether the CPU has SYSENTER and the fast syscall path is set up
+bool sysenter_enabled = false;
 
 // ----- debugging/example variables -----
 bool memory_mode = false;
@@ -166,14 +188,34 @@ void terminal_putchar(char c)
 	}
 }
 
+// writes exactly size bytes, NULs included, straight into the VGA buffer.
+// the cursor lives in locals for the whole run and only newlines leave the
+// loop, so a program's whole write() is drawn in one pass.
 void terminal_write(const char* data, size_t size)
 {
-	for (size_t i = 0; i < size; i++)
-		if (data[i] == 0x0A) {
+	size_t row = terminal_row;
+	size_t column = terminal_column;
+	const uint8_t color = terminal_color;
+
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] == '\n') {
+			terminal_row = row;
 			terminal_advance_row();
-		} else {
-			terminal_putchar(data[i]);
+			row = terminal_row;
+			column = terminal_column;
+			continue;
 		}
+
+		terminal_buffer[row * VGA_WIDTH + column] = vga_entry(data[i], color);
+		if (++column == VGA_WIDTH) {
+			column = 0;
+			if (++row == VGA_HEIGHT)
+				row = 0;
+		}
+	}
+
+	terminal_row = row;
+	terminal_column = column;
 }
 
 void terminal_writeint(int num) {
@@ -252,6 +294,66 @@ void idt_set_descriptor(uint8_t interrupt_num, void* offset, uint8_t flags) {
 	IDT[interrupt_num].offset_upperbits = ((uint32_t)offset & 0xFFFF0000) >> 16;
 }
 
+// purpose: adds one interrupt to an IRQ's latency counters
+// stats: the counters for the IRQ
+// start: the TSC when the handler started
+void record_irq_latency(IRQ_stats* stats, uint64_t start) {
+	uint32_t cycles = (uint32_t)(read_tsc() - start);
+	stats->count++;
+	stats->total_cycles += cycles;
+	if (cycles > stats->max_cycles) stats->max_cycles = cycles;
+}
+
+// purpose: prints how long each IRQ handler has kept interrupts disabled
+void print_irq_stats() {
+	static const char* names[IRQ_STATS_COUNT] = {"clock   ", "keyboard"};
+	terminal_writestring("IRQ        COUNT  AVG CYCLES  MAX CYCLES\n");
+	for (uint8_t i = 0; i < IRQ_STATS_COUNT; i++) {
+		IRQ_stats* stats = &irq_stats[i];
+		// scale both down until the total fits in 32 bits, since there is
+		// no 64-bit divide without libgcc
+		uint64_t total = stats->total_cycles;
+		uint32_t count = stats->count;
+		while (total >> 32) {
+			total >>= 1;
+			count >>= 1;
+		}
+		terminal_writestring(names[i]);
+		terminal_writestring("  ");
+		terminal_writeint(stats->count);
+		terminal_writestring("  ");
+		terminal_writeint(count ? (uint32_t)total / count : 0);
+		terminal_writestring("  ");
+		terminal_writeint(stats->max_cycles);
+		terminal_writestring("\n");
+	}
+}
+
+// purpose: times a null syscall (getpid) through int 0x80 and through
+//          SYSENTER, and prints the average cost of each in cycles
+void run_syscall_benchmark() {
+	uint64_t start = read_tsc();
+	for (uint32_t i = 0; i < SYSBENCH_ITERATIONS; i++) syscall_int80(SYSBENCH_SYSCALL);
+	uint32_t int80_cycles = (uint32_t)(read_tsc() - start);
+
+	terminal_writestring("int 0x80: ");
+	terminal_writeint(int80_cycles / SYSBENCH_ITERATIONS);
+	terminal_writestring(" cycles per call\n");
+
+	if (!sysenter_enabled) {
+		terminal_writestring("sysenter: not supported by this CPU\n");
+		return;
+	}
+
+	start = read_tsc();
+	for (uint32_t i = 0; i < SYSBENCH_ITERATIONS; i++) syscall_sysenter(SYSBENCH_SYSCALL);
+	uint32_t sysenter_cycles = (uint32_t)(read_tsc() - start);
+
+	terminal_writestring("sysenter: ");
+	terminal_writeint(sysenter_cycles / SYSBENCH_ITERATIONS);
+	terminal_writestring(" cycles per call\n");
+}
+
 void init_pit(uint32_t divisor) {
     // Command byte: Channel 0, low/high byte, rate generator mode
     ioport_out(PIT_COMMAND_MODE_PORT, 0x36);
@@ -264,12 +366,19 @@ void init_pit(uint32_t divisor) {
     ioport_out(PIC1_DATA_PORT, ioport_in(0x21) & ~(1 << 0));
 }
 
-void handle_clock_interrupt() {
+// eip: the instruction that was interrupted
+void handle_clock_interrupt(uint32_t eip) {
+	uint64_t start = read_tsc();
 	// clear interrupt; tells PIC we
 	// are handling it.
 	ioport_out(PIC1_COMMAND_PORT, 0x20);
 
 	// terminal_writestring("clock");
+	account_process_tick(eip);
+	advance_timers();
+	vdso_tick(start);
+	// the switch itself isn't counted: it returns in another process
+	record_irq_latency(&irq_stats[IRQ_CLOCK], start);
 	switch_process_from_queue();
 
 }
@@ -340,80 +449,203 @@ void init_kb() {
 }
 
 
+// purpose: keyboard top half. runs with interrupts off, so it only moves the
+//          scancode into scancode_ring and wakes the shell thread. everything
+//          else, including running commands, happens in keyboard_bottom_half.
 void handle_keyboard_interrupt() {
+    uint64_t start = read_tsc();
     ioport_out(PIC1_COMMAND_PORT, 0x20);
     unsigned char status = ioport_in(KEYBOARD_STATUS_PORT);
     if (status & 0x1) {
-        char keycode = ioport_in(KEYBOARD_DATA_PORT);
-        // Handle special keys
-        if((uint8_t)keycode == 0xE0 || (uint8_t)keycode == 224) {
-            keycode = ioport_in(KEYBOARD_DATA_PORT);
-        }
-        // Handle modifier keys
-        if (keycode == 0x2A || (uint8_t)keycode == 0xAA ||
-            keycode == 0x36 || (uint8_t)keycode == 0xB6) {
-            special_key_state.shift = 1 - ((uint8_t)keycode >> 7);
-            return;
+        uint8_t keycode = ioport_in(KEYBOARD_DATA_PORT);
+        // drop the key rather than block if the shell has fallen this far behind
+        if (mpsc_ring_push(&scancode_ring, &keycode)) {
+            wake_queue(&keyboard_waiters, 1);
         }
-        else if (keycode == 0x38 || (uint8_t)keycode == 0xB8) {
-            special_key_state.alt = 1 - ((uint8_t)keycode >> 7);
-            return;
-        }
-        else if (keycode == 0x1D || (uint8_t)keycode == 0x9D) {
-            special_key_state.ctrl = 1 - ((uint8_t)keycode >> 7);
-            return;
-        }
-        else if(keycode == 0x3A) {
-            special_key_state.caps = 1 - special_key_state.caps;
-            return;
+    }
+    record_irq_latency(&irq_stats[IRQ_KEYBOARD], start);
+}
+
+// purpose: keyboard bottom half for one scancode: tracks modifier keys, edits
+//          the command line and runs the command on enter. runs in the shell
+//          thread with interrupts enabled.
+// scancode: a byte read from the keyboard by the top half
+void handle_scancode(uint8_t scancode) {
+    char keycode = scancode;
+    // Handle special keys: skip the 0xE0 prefix and treat the byte after
+    // it like a normal scancode
+    if((uint8_t)keycode == 0xE0 || (uint8_t)keycode == 224) {
+        return;
+    }
+    // Handle modifier keys
+    if (keycode == 0x2A || (uint8_t)keycode == 0xAA ||
+        keycode == 0x36 || (uint8_t)keycode == 0xB6) {
+        special_key_state.shift = 1 - ((uint8_t)keycode >> 7);
+        return;
+    }
+    else if (keycode == 0x38 || (uint8_t)keycode == 0xB8) {
+        special_key_state.alt = 1 - ((uint8_t)keycode >> 7);
+        return;
+    }
+    else if (keycode == 0x1D || (uint8_t)keycode == 0x9D) {
+        special_key_state.ctrl = 1 - ((uint8_t)keycode >> 7);
+        return;
+    }
+    else if(keycode == 0x3A) {
+        special_key_state.caps = 1 - special_key_state.caps;
+        return;
+    }
+    // Ignore key releases
+    if ((uint8_t)keycode > 127) return;
+    // Handle enter key - process command
+    if (keyboard_map[(uint8_t)keycode] == '\n') {
+        cmd_buffer[cmd_pos] = '\0';
+        ramfs_write(STDIN_FILENO, (const void *)"\n", 1);
+        ramfs_write(STDOUT_FILENO, (const void *)"\n", 1);
+        terminal_putchar('\n');
+        if (current_dir && cmd_pos > 0) {
+            handle_command(cmd_buffer);
         }
-        // Ignore key releases
-        if ((uint8_t)keycode > 127) return;
-        // Handle enter key - process command
-        if (keyboard_map[(uint8_t)keycode] == '\n') {
-            cmd_buffer[cmd_pos] = '\0';
-            ramfs_write(STDIN_FILENO, (const void *)"\n", 1);
-            ramfs_write(STDOUT_FILENO, (const void *)"\n", 1);
-            terminal_putchar('\n');
-            if (current_dir && cmd_pos > 0) {
-                handle_command(cmd_buffer);
+        cmd_pos = 0;
+        terminal_writestring("shompOS> ");
+        return;
+    }
+    // Handle backspace (scan code 0x0E)
+    else if (keycode == 0x0E) {
+        if (cmd_pos > 0) {
+            cmd_pos--;
+            if (terminal_column > strlen("shompOS> ")) {
+                terminal_column--;
+                terminal_putentryat(' ', terminal_color, terminal_column, terminal_row);
+                terminal_buffer[terminal_row * VGA_WIDTH + terminal_column] = vga_entry(' ', terminal_color);
             }
-            cmd_pos = 0;
-            terminal_writestring("shompOS> ");
-            return;
         }
-        // Handle backspace (scan code 0x0E)
-        else if (keycode == 0x0E) {
-            if (cmd_pos > 0) {
-                cmd_pos--;
-                if (terminal_column > strlen("shompOS> ")) {
-                    terminal_column--;
-                    terminal_putentryat(' ', terminal_color, terminal_column, terminal_row);
-                    terminal_buffer[terminal_row * VGA_WIDTH + terminal_column] = vga_entry(' ', terminal_color);
-                }
+        return;
+    }
+    // Add character to command buffer
+    else if (cmd_pos < CMD_MAX_LEN - 1) {
+        char c = keyboard_map[(uint8_t)keycode];
+        if (c >= 'a' && c <= 'z') {
+            if ((special_key_state.shift ^ special_key_state.caps) == 1) {
+                c -= 32;
             }
-            return;
+        } else if (special_key_state.shift) {
+            c = keyboard_map_shift[(uint8_t)keycode];
         }
-        // Add character to command buffer
-        else if (cmd_pos < CMD_MAX_LEN - 1) {
-            char c = keyboard_map[(uint8_t)keycode];
-            if (c >= 'a' && c <= 'z') {
-                if ((special_key_state.shift ^ special_key_state.caps) == 1) {
-                    c -= 32;
-                }
-            } else if (special_key_state.shift) {
-                c = keyboard_map_shift[(uint8_t)keycode];
-            }
-            if (c >= 32 && c <= 126) {  // Only printable characters
-                cmd_buffer[cmd_pos++] = c;
-                ramfs_write(STDIN_FILENO, &c, 1);
-                ramfs_write(STDOUT_FILENO, &c, 1);
-            }
+        if (c >= 32 && c <= 126) {  // Only printable characters
+            cmd_buffer[cmd_pos++] = c;
+            ramfs_write(STDIN_FILENO, &c, 1);
+            ramfs_write(STDOUT_FILENO, &c, 1);
+        }
+    }
+}
+
+// purpose: body of the shell thread. waits for the keyboard top half to queue
+//          scancodes and handles them one at a time.
+void keyboard_bottom_half(void* arg) {
+    (void)arg;
+
+    while (1) {
+        uint8_t scancode;
+
+        // the check and the sleep happen with interrupts off so a key that
+        // arrives in between still finds us on the queue
+        uint32_t flags = save_and_disable_interrupts();
+        while (!mpsc_ring_pop(&scancode_ring, &scancode)) {
+            wait_on_queue(&keyboard_waiters);
         }
+        restore_interrupts(flags);
+
+        handle_scancode(scancode);
+    }
+}
+
+// purpose: strips surrounding spaces and an optional leading "run " from
+//          one side of a pipeline, leaving just the executable name
+static char* pipeline_stage_name(char* stage) {
+    while (*stage == ' ') stage++;
+    if (strncmp(stage, "run ", 4) == 0) stage += 4;
+    while (*stage == ' ') stage++;
+
+    size_t len = strlen(stage);
+    while (len > 0 && stage[len - 1] == ' ') stage[--len] = '\0';
+    return stage;
+}
+
+// purpose: runs "left | right". both sides name executables in the current
+//          directory. left's stdout feeds right's stdin through a pipe, so the
+//          data never goes through a file in ramfs.
+void handle_pipeline(char* left, char* right) {
+    left = pipeline_stage_name(left);
+    right = pipeline_stage_name(right);
+    if (*left == '\0' || *right == '\0') {
+        terminal_writestring("Usage: <program> | <program>\n");
+        return;
+    }
+
+    int fds[2];
+    if (ramfs_pipe(fds)) {
+        terminal_writestring("Failed to create pipe\n");
+        return;
+    }
+
+    // the reader goes first so it owns the read end before anything is
+    // written. if a side fails to start, closing its end lets the other side
+    // see EOF (or a broken pipe) instead of blocking forever. the shell can
+    // be preempted, so interrupts stay off until each side has its pipe end;
+    // otherwise it could run first and use the keyboard or terminal.
+    uint32_t flags = save_and_disable_interrupts();
+    int reader = ramfs_run(current_dir, right);
+    if (reader == -1) {
+        ramfs_close(fds[0]);
+    } else {
+        set_process_stdio(reader, STDIN_FILENO, fds[0]);
     }
+    restore_interrupts(flags);
+
+    flags = save_and_disable_interrupts();
+    int writer = ramfs_run(current_dir, left);
+    if (writer == -1) {
+        ramfs_close(fds[1]);
+    } else {
+        set_process_stdio(writer, STDOUT_FILENO, fds[1]);
+    }
+    restore_interrupts(flags);
+}
+
+// purpose: the strace command. turns syscall tracing on and off and prints
+//          what it recorded
+// args: "on [pid]", "off", "stats", "log" or "clear"
+void run_strace_command(char* args) {
+	if (args && strncmp(args, "on", 2) == 0 && (args[2] == '\0' || args[2] == ' ')) {
+		processID pid = 0;
+		for (char* c = args + 2; *c; c++) {
+			if (*c >= '0' && *c <= '9') pid = pid * 10 + (*c - '0');
+		}
+		set_syscall_trace(SYSCALL_TRACE_STATS | SYSCALL_TRACE_LOG, pid);
+	} else if (args && strcmp(args, "off") == 0) {
+		set_syscall_trace(0, 0);
+	} else if (args && strcmp(args, "stats") == 0) {
+		print_syscall_stats();
+	} else if (args && strcmp(args, "log") == 0) {
+		print_syscall_log();
+	} else if (args && strcmp(args, "clear") == 0) {
+		clear_syscall_trace();
+	} else {
+		terminal_writestring("Usage: strace on [pid] | off | stats | log | clear\n");
+	}
 }
 
 void handle_command(char* cmd) {
+     // Split off a pipeline before anything else
+     for (size_t i = 0; cmd[i] != '\0'; i++) {
+         if (cmd[i] == '|') {
+             cmd[i] = '\0';
+             handle_pipeline(cmd, &cmd[i + 1]);
+             return;
+         }
+     }
+
      // Split command and arguments
      char* cmd_name = cmd;
      char* args = NULL;
@@ -436,6 +668,18 @@ void handle_command(char* cmd) {
      else if (strcmp(cmd_name, "pwd") == 0) {
          ramfs_pwd(current_dir);
      }
+     else if (strcmp(cmd_name, "top") == 0 || strcmp(cmd_name, "ps") == 0) {
+         print_process_table();
+     }
+     else if (strcmp(cmd_name, "irqstat") == 0) {
+         print_irq_stats();
+     }
+     else if (strcmp(cmd_name, "sysbench") == 0) {
+         run_syscall_benchmark();
+     }
+     else if (strcmp(cmd_name, "strace") == 0) {
+         run_strace_command(args);
+     }
      else if (strcmp(cmd_name, "cat") == 0) {
          if (!args) {
              terminal_writestring("Usage: cat <filename>\n");
@@ -464,6 +708,15 @@ void handle_command(char* cmd) {
          }
          ramfs_rm(current_dir, args);
      }
+     else if (strcmp(cmd_name, "mv") == 0) {
+         char* new_path = args ? strchr(args, ' ') : NULL;
+         if (!new_path) {
+             terminal_writestring("Usage: mv <old> <new>\n");
+             return;
+         }
+         *new_path++ = '\0';
+         ramfs_mv(current_dir, args, new_path);
+     }
      else if (strcmp(cmd_name, "help") == 0) {
          terminal_writestring("Available commands:\n");
          terminal_writestring("  clear        Clear the screen\n");
@@ -473,6 +726,12 @@ void handle_command(char* cmd) {
          terminal_writestring("  touch <file> Create empty file\n");
          terminal_writestring("  mkdir <dir> Create directory\n");
          terminal_writestring("  rm <file>   Remove file\n");
+         terminal_writestring("  mv <a> <b>  Move or rename file a to b\n");
+         terminal_writestring("  a | b       Pipe program a into program b\n");
+         terminal_writestring("  top, ps     Show load and per-process CPU use\n");
+         terminal_writestring("  irqstat     Show time spent with interrupts off\n");
+         terminal_writestring("  sysbench    Time int 0x80 against sysenter\n");
+         terminal_writestring("  strace      Count, time and log syscalls\n");
          terminal_writestring("  help        Show this help message\n");
      }
      else if (strcmp(cmd_name, "cd") == 0) {
@@ -480,7 +739,7 @@ void handle_command(char* cmd) {
              terminal_writestring("Usage: rm <filename>\n");
              return;
          }
-         ramfs_dir_t *result_dir = ramfs_cd(system_root, args);
+         ramfs_dir_t *result_dir = ramfs_cd(current_dir, args);
          if (result_dir) {
              current_dir = result_dir;
          }
@@ -676,7 +935,7 @@ void_command(char* cmd) {
             terminal_writestring("Usage: cd <filename>\n");
             return;
         }
-        ramfs_dir_t *result_dir = ramfs_cd(system_root, args);
+        ramfs_dir_t *result_dir = ramfs_cd(current_dir, args);
         if (result_dir) {
             current_dir = result_dir;
         }
@@ -795,6 +1054,11 @@ void init_shell(ramfs_dir_t* root) {
 void kernel_main() {
     init_terminal();
   	init_idt();
+  	sysenter_enabled = init_sysenter();
+    // the keyboard interrupt pushes into the ring and wakes the queue, so
+    // both must exist first
+    mpsc_ring_init(&scancode_ring, scancode_storage, sizeof(uint8_t), SCANCODE_RING_SIZE);
+    init_wait_queue(&keyboard_waiters);
   	init_kb();
   	init_heap(HEAP_LOWER_BOUND);
   	enable_interrupts();
@@ -817,11 +1081,18 @@ void kernel_main() {
     void* ap3 = allocate(500);
 
     init_process(&terminal_backstop, ap);
+    init_reaper();
+    init_workers();
+    create_kthread(&keyboard_bottom_half, NULL);
     init_process(&sample2, ap2);
     init_process(&sample3, ap3);
     init_process(&test_jump, allocate(500));
 
 
+    init_timers();
+    init_vdso();
+    init_futex();
+    init_process_accounting();
     init_pit(PIT_DIVISOR);
     enable_interrupts();
 
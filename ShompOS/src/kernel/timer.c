@@ -0,0 +1,118 @@
+// timer.c
+// Hierarchical timer wheel driven by the PIT
+// Cedarville University 2024-25 OSDev Team
+
+#include <kernel/timer.h>
+#include <kernel/boot.h>
+
+// level 0 holds timers due within the next 64 ticks, one slot per tick. each
+// higher level holds timers 64x further out. when the lower level wraps, the
+// matching slot of the level above is cascaded down. adding and cancelling
+// are O(1) list operations, and a tick only touches the slots it lands on, so
+// idle timers cost nothing per tick.
+static list_header timer_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+// ticks since init_timers(). wraps after ~170 days at the default PIT rate.
+static volatile uint32_t current_tick = 0;
+
+// purpose: places a timer in the wheel slot that matches its expiry
+// timer: a detached timer with expires already set
+static void __timer_enqueue(timer_struct* timer) {
+    uint32_t delta = timer->expires - current_tick;
+    uint8_t level = 0;
+
+    if (delta > TIMER_MAX_DELAY) {
+        delta = TIMER_MAX_DELAY;
+        timer->expires = current_tick + delta;
+    }
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           delta >= (1u << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+
+    uint32_t slot = (timer->expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+    list_add_tail(&timer_wheel[level][slot], &timer->list);
+}
+
+// purpose: moves every timer in a higher level slot down to the level that
+//          now matches its remaining delay
+// level: the level to cascade from (never 0)
+// slot: the slot within that level
+static void __timer_cascade(uint8_t level, uint32_t slot) {
+    list_header* head = &timer_wheel[level][slot];
+
+    while (!is_end_of_list(head)) {
+        timer_struct* timer = (timer_struct*)head->next;
+        list_remove(&timer->list);
+        __timer_enqueue(timer);
+    }
+}
+
+// purpose: empties every slot of the wheel
+void init_timers() {
+    for (uint8_t level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (uint32_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            init_list(&timer_wheel[level][slot]);
+        }
+    }
+    current_tick = 0;
+}
+
+// purpose: arms a timer. re-arming a pending timer moves it.
+// timer: caller owned storage for the timer. must stay valid until it fires
+//        or is cancelled
+// ticks: how many ticks from now to fire. 0 is treated as 1
+// callback: called from the clock interrupt with arg when the timer fires
+void add_timer(timer_struct* timer, uint32_t ticks, timer_callback callback, void* arg) {
+    uint32_t flags = save_and_disable_interrupts();
+
+    if (timer_pending(timer)) list_remove(&timer->list);
+    if (!ticks) ticks = 1;
+
+    timer->expires = current_tick + ticks;
+    timer->callback = callback;
+    timer->arg = arg;
+    __timer_enqueue(timer);
+
+    restore_interrupts(flags);
+}
+
+// purpose: disarms a timer. harmless if it already fired or was never armed.
+// timer: the timer to disarm
+void cancel_timer(timer_struct* timer) {
+    uint32_t flags = save_and_disable_interrupts();
+    if (timer_pending(timer)) list_remove(&timer->list);
+    restore_interrupts(flags);
+}
+
+// purpose: checks whether a timer is still waiting to fire
+// returns: true if the timer is linked into the wheel
+bool timer_pending(timer_struct* timer) {
+    return timer->list.next != NULL && timer->list.next != &timer->list;
+}
+
+// purpose: advances the wheel by one tick and runs every timer that expires
+//          on it. called from the clock interrupt with interrupts disabled.
+void advance_timers() {
+    current_tick++;
+
+    // cascade each level whose lower neighbour just wrapped around
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if (current_tick & ((1u << (TIMER_WHEEL_BITS * level)) - 1)) break;
+        __timer_cascade(level, (current_tick >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+    }
+
+    // a callback may re-arm its own timer. it lands in a later slot since
+    // the minimum delay is one tick, so this loop always terminates.
+    list_header* head = &timer_wheel[0][current_tick & TIMER_WHEEL_MASK];
+    while (!is_end_of_list(head)) {
+        timer_struct* timer = (timer_struct*)head->next;
+        list_remove(&timer->list);
+        timer->callback(timer->arg);
+    }
+}
+
+// returns: the number of clock ticks since the timers were initialized
+uint32_t get_ticks() {
+    return current_tick;
+}
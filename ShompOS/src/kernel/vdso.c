@@ -0,0 +1,75 @@
+// vdso.c
+// Keeps the data page programs read without a syscall up to date
+// Cedarville University 2024-25 OSDev Team
+
+#include <kernel/vdso_page.h>
+#include <kernel/timer.h>
+#include <kernel/boot.h>
+
+// there is no paging, so every process already sees this at the same
+// address and nothing stops a program writing it. it sits on its own page
+// so it can be mapped read-only once there is paging.
+vdso_data vdso_page_data __attribute__((aligned(4096)));
+
+// milliseconds of the current tick not yet added to uptime_ms, in units of
+// 1/PIT_FREQUENCY ms
+static uint32_t ms_remainder;
+
+// purpose: starts a write. readers retry while the sequence is odd or has
+//          moved, so they never act on a half written update
+// returns: the interrupt flags to pass to __vdso_write_end
+static uint32_t __vdso_write_begin() {
+    uint32_t flags = save_and_disable_interrupts();
+    vdso_page_data.sequence++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return flags;
+}
+
+static void __vdso_write_end(uint32_t flags) {
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    vdso_page_data.sequence++;
+    restore_interrupts(flags);
+}
+
+// purpose: fills in the page before the first tick
+void init_vdso() {
+    uint32_t flags = __vdso_write_begin();
+    vdso_page_data.ticks = 0;
+    vdso_page_data.ticks_per_second = TICKS_PER_SECOND;
+    vdso_page_data.uptime_ms = 0;
+    vdso_page_data.tick_tsc = read_tsc();
+    vdso_page_data.tick_cycles = 0;
+    vdso_page_data.pid = 0;
+    vdso_page_data.tid = 0;
+    ms_remainder = 0;
+    __vdso_write_end(flags);
+}
+
+// purpose: publishes the clock. called from the clock interrupt
+// tsc: the TSC when the interrupt came in
+void vdso_tick(uint64_t tsc) {
+    uint32_t flags = __vdso_write_begin();
+
+    // a tick is PIT_DIVISOR / PIT_FREQUENCY seconds, which isn't a whole
+    // number of milliseconds, so carry the fraction over
+    ms_remainder += 1000 * PIT_DIVISOR;
+    vdso_page_data.uptime_ms += ms_remainder / PIT_FREQUENCY;
+    ms_remainder %= PIT_FREQUENCY;
+
+    vdso_page_data.ticks = get_ticks();
+    vdso_page_data.tick_cycles = (uint32_t)(tsc - vdso_page_data.tick_tsc);
+    vdso_page_data.tick_tsc = tsc;
+
+    __vdso_write_end(flags);
+}
+
+// purpose: publishes who is on the CPU. called by the scheduler just before
+//          it switches, so whoever reads the page sees itself
+// pid: the process (thread group) being switched to
+// tid: the thread being switched to
+void vdso_set_active(uint32_t pid, uint32_t tid) {
+    uint32_t flags = __vdso_write_begin();
+    vdso_page_data.pid = pid;
+    vdso_page_data.tid = tid;
+    __vdso_write_end(flags);
+}
@@ -304,6 +304,18 @@ int8_t sbrk(int32_t inc) {
     else return brk(current_brk + (inc<<MAX_BLOCK_SCALE));
 }
 
+// purpose: checks that a range of memory lies entirely inside the heap. with
+//          no paging, this is what separates a pointer a program may hand the
+//          kernel from one into the kernel image.
+// addr: the start of the range
+// size: its length in bytes
+// returns: true if every byte is between the heap base and the brk
+bool heap_contains(const void* addr, size_t size) {
+    uintptr_t start = (uintptr_t)addr;
+    return start >= HEAP_LOWER_BOUND && start + size >= start &&
+           start + size <= (uintptr_t)current_brk;
+}
+
 
 // ----- FOR DEBUGGING ------
 // stole from Claude
@@ -0,0 +1,84 @@
+// brk.c
+// Per process program break, for user space allocators
+// Cedarville University 2024-25 OSDev Team
+
+// the break belongs to the whole process, so threads share it through their
+// group leader. chunks stay with the process until it exits, even once the
+// break has moved on to a newer one.
+
+#include <process/brk.h>
+#include <kernel/boot.h>
+#include <string.h>
+
+// purpose: finds the thread that holds a process' break
+// returns: the group leader of PID, or NULL
+static process_struct* __brk_owner(processID PID) {
+    process_struct* proc = get_process(PID);
+    return proc ? get_process(proc->TGID) : NULL;
+}
+
+// purpose: moves a process' break by a relative amount
+// PID: any thread of the process
+// increment: bytes to grow by, or to shrink by if negative. shrinking stops
+//            at the start of the current chunk
+// returns: the old break, which is the start of the new memory when growing,
+//          or (void*)-1 on failure. if the request didn't fit in the current
+//          chunk, the new memory starts a new chunk instead. there is no
+//          break until the first growing call, so anything else fails then
+void* process_sbrk(processID PID, int32_t increment) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* proc = __brk_owner(PID);
+    void* old = (void*)-1;
+
+    if (!proc) {
+        // nothing to do
+    } else if (proc->brk && increment <= proc->brk_limit - proc->brk &&
+               increment >= proc->brk_start - proc->brk) {
+        old = proc->brk;
+        proc->brk += increment;
+    } else if (increment > 0 && (uint32_t)increment <= BRK_CHUNK_SIZE) {
+        list_header* chunk = allocate(BRK_CHUNK_ALLOC);
+        if (chunk) {
+            // the heap is shared, so don't hand over what the last owner left
+            memset(chunk + 1, 0, BRK_CHUNK_SIZE);
+            list_add_tail(&proc->brk_chunks, chunk);
+            proc->brk_start = (char*)(chunk + 1);
+            proc->brk_limit = proc->brk_start + BRK_CHUNK_SIZE;
+            proc->brk = proc->brk_start + increment;
+            old = proc->brk_start;
+        }
+    }
+
+    restore_interrupts(flags);
+    return old;
+}
+
+// purpose: sets a process' break to an absolute address
+// PID: any thread of the process
+// addr: the new break. must lie in the current chunk
+// returns: 0 on success, -1 on failure
+int process_brk(processID PID, void* addr) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* proc = __brk_owner(PID);
+    int result = -1;
+
+    if (proc && proc->brk_start && (char*)addr >= proc->brk_start && (char*)addr <= proc->brk_limit) {
+        proc->brk = addr;
+        result = 0;
+    }
+
+    restore_interrupts(flags);
+    return result;
+}
+
+// purpose: frees every chunk a process' break ever used. called by the
+//          reaper once the process is gone
+// proc: the group leader
+void release_process_brk(process_struct* proc) {
+    while (!is_end_of_list(&proc->brk_chunks)) {
+        list_header* chunk = proc->brk_chunks.next;
+        list_remove(chunk);
+        free(chunk);
+    }
+    proc->brk_start = proc->brk = proc->brk_limit = NULL;
+}
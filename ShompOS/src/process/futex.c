@@ -0,0 +1,103 @@
+// futex.c
+// Fast user-space mutex support: wait on an address, wake its waiters
+// Cedarville University 2024-25 OSDev Team
+
+// user-space locks keep their state in an ordinary word and only enter the
+// kernel when they are contended. the kernel keeps no per-lock state at all,
+// just the processes sleeping on an address.
+
+#include <process/futex.h>
+#include <process/process.h>
+#include <kernel/boot.h>
+#include <kernel/timer.h>
+
+static wait_queue futex_buckets[FUTEX_HASH_BUCKETS];
+
+// purpose: picks the bucket for an address. words are at least 4 byte
+//          aligned, so the low bits carry no information.
+static wait_queue* __futex_bucket(volatile uint32_t* addr) {
+    uint32_t key = (uint32_t)addr >> 2;
+    key ^= key >> 6;
+    key ^= key >> 12;
+    return &futex_buckets[key & (FUTEX_HASH_BUCKETS - 1)];
+}
+
+static void __futex_timeout_callback(void* arg) {
+    wake_process((processID)arg);
+}
+
+// purpose: empties every bucket
+void init_futex() {
+    for (uint32_t i = 0; i < FUTEX_HASH_BUCKETS; i++) {
+        init_wait_queue(&futex_buckets[i]);
+    }
+}
+
+// purpose: blocks the active process if *addr still holds the value the
+//          caller last saw. the check and the sleep happen with interrupts
+//          disabled, so a wake between them cannot be lost.
+// addr: the futex word
+// expected: the value the caller saw in *addr
+// timeout_ticks: how long to wait at most. 0 waits forever
+// returns: 0 when woken by futex_wake, -1 if *addr had already changed, the
+//          timeout ran out, or the caller cannot block
+int futex_wait(volatile uint32_t* addr, uint32_t expected, uint32_t timeout_ticks) {
+    if (!addr || ((uint32_t)addr & 3)) return -1;
+
+    processID pid = get_active_pid();
+    process_struct* proc = get_process(pid);
+    if (proc == NULL || pid == 0) return -1;
+
+    uint32_t flags = save_and_disable_interrupts();
+    if (*addr != expected) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    // the timer belongs to the process, so kill_process() can cancel it and
+    // unlink us from the bucket if we die while waiting
+    if (timeout_ticks) {
+        add_timer(&proc->sleep_timer, timeout_ticks, &__futex_timeout_callback, (void*)pid);
+    }
+
+    proc->wait_key = (void*)addr;
+    int rc = wait_on_queue(__futex_bucket(addr));
+    cancel_timer(&proc->sleep_timer);
+
+    // futex_wake clears the key. still set means something else woke us.
+    if (proc->wait_key != NULL) {
+        proc->wait_key = NULL;
+        rc = -1;
+    }
+
+    restore_interrupts(flags);
+    return rc;
+}
+
+// purpose: wakes processes waiting on an address, oldest first
+// addr: the futex word
+// count: the maximum number of waiters to wake
+// returns: the number of processes woken
+uint32_t futex_wake(volatile uint32_t* addr, uint32_t count) {
+    if (!addr) return 0;
+
+    uint32_t flags = save_and_disable_interrupts();
+    wait_queue* bucket = __futex_bucket(addr);
+    list_header* node = bucket->waiters.next;
+    uint32_t woken = 0;
+
+    while (woken < count && node != &bucket->waiters) {
+        process_struct* proc = container_of(node, process_struct, wait_link);
+        node = node->next;
+
+        if (proc->wait_key == (void*)addr) {
+            proc->wait_key = NULL;
+            list_remove(&proc->wait_link);
+            wake_process(proc->PID);
+            woken++;
+        }
+    }
+
+    restore_interrupts(flags);
+    return woken;
+}
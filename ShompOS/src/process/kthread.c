@@ -0,0 +1,94 @@
+// kthread.c
+// Kernel threads and a deferred work queue served by worker threads
+// Cedarville University 2024-25 OSDev Team
+
+#include <process/kthread.h>
+#include <kernel/boot.h>
+#include <memory/heap.h>
+
+// work items waiting for a worker. head and tail count items ever taken and
+// added, so tail - head is the number pending.
+static work_item work_queue[WORK_QUEUE_SIZE];
+static uint32_t work_head = 0;
+static uint32_t work_tail = 0;
+static wait_queue idle_workers;
+
+// purpose: first code a kernel thread runs. calls the thread function with
+//          its argument. returning from here lands in kill_process, the
+//          same as any other process returning.
+static void __kthread_trampoline() {
+    process_struct* proc = get_process(get_active_pid());
+    ((kthread_fn)proc->start_routine)(proc->start_arg);
+}
+
+// purpose: starts a kernel thread: a process running a kernel function on its
+//          own stack. like any process it starts on the next tick.
+// fn: the function to run. the thread exits when it returns
+// arg: passed to fn
+// returns: the PID of the thread, or -1 on failure
+processID create_kthread(kthread_fn fn, void* arg) {
+    void* stack = allocate(KTHREAD_STACK_SIZE);
+    if (!stack) return -1;
+
+    uint32_t flags = save_and_disable_interrupts();
+    processID pid = init_process(&__kthread_trampoline, stack);
+    process_struct* proc = get_process(pid);
+    if (proc == NULL) {
+        restore_interrupts(flags);
+        free(stack);
+        return -1;
+    }
+    proc->start_routine = fn;
+    proc->start_arg = arg;
+    restore_interrupts(flags);
+
+    return pid;
+}
+
+// purpose: body of each worker thread. runs queued work in order, sleeping
+//          while there is none.
+static void __worker_main(void* arg) {
+    (void)arg;
+
+    while (1) {
+        uint32_t flags = save_and_disable_interrupts();
+        while (work_head == work_tail) wait_on_queue(&idle_workers);
+
+        work_item item = work_queue[work_head % WORK_QUEUE_SIZE];
+        work_head++;
+        restore_interrupts(flags);
+
+        item.fn(item.arg);
+    }
+}
+
+// purpose: starts the worker pool. call once processes can be created.
+void init_workers() {
+    init_wait_queue(&idle_workers);
+    for (uint8_t i = 0; i < WORKER_COUNT; i++) {
+        create_kthread(&__worker_main, NULL);
+    }
+}
+
+// purpose: hands a function to the worker pool to run later in process
+//          context, with interrupts enabled. safe to call from an interrupt
+//          handler, which can then return right away.
+// fn: the function to run
+// arg: passed to fn
+// returns: 0 on success, -1 if the queue is full
+int queue_work(kthread_fn fn, void* arg) {
+    uint32_t flags = save_and_disable_interrupts();
+
+    if (work_tail - work_head == WORK_QUEUE_SIZE) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    work_queue[work_tail % WORK_QUEUE_SIZE].fn = fn;
+    work_queue[work_tail % WORK_QUEUE_SIZE].arg = arg;
+    work_tail++;
+    wake_queue(&idle_workers, 1);
+
+    restore_interrupts(flags);
+    return 0;
+}
@@ -1,7 +1,14 @@
 #include <process/process.h>
 #include <process/context_switch.h>
 #include <kernel/kernel.h>
+#include <kernel/boot.h>
+#include <kernel/timer.h>
+#include <kernel/vdso_page.h>
 #include <memory/heap.h>
+#include <fs/ramfs.h>
+#include <fs/mmap.h>
+#include <process/brk.h>
+#include <process/shm.h>
 
 // proccess 0 is reserved for the backstop process, a process that will only be
 // run when no other processes are active.
@@ -9,6 +16,16 @@ static process_struct proc_table[MAX_PROCESS];
 processID active_pid = -1;
 processID next_pid = -1;
 
+// exponentially decaying averages of the runnable process count over 1, 5
+// and 15 minutes, in LOAD_FIXED_SHIFT fixed point
+static uint32_t load_average[3] = {0, 0, 0};
+static timer_struct load_timer;
+
+// processes that have exited but still own memory, and the reaper that frees
+// it. zombies are linked through their wait_link.
+static list_header zombie_list;
+static wait_queue reaper_queue;
+
 // purpose: finds the next open spot in the proc_table
 // returns: a pointer to the open slot, if all slots are full, returns NULL
 process_struct* reserve_proc_table_slot() {
@@ -57,17 +74,179 @@ processID get_next_PID() {
     return next_pid;
 }
 
-// purpose: stops a process from being scheduled in the future. frees reserved
-//          memory back to the pool.
+// purpose: stops a process from being scheduled in the future. the process
+//          becomes a zombie and the reaper frees its memory later, since a
+//          process killing itself is still running on the stack to be freed.
+//          killing the first thread of a thread group kills the whole group,
+//          since the other threads run code from its image.
+//          if PID is the active process this never returns.
 // PID: the PID to kill
 void kill_process(processID PID) {
+    uint32_t flags = save_and_disable_interrupts();
     process_struct* proc = get_process(PID);
-    if (proc != NULL){
+
+    if (proc != NULL && proc->status != ZOMBIE){
+        bool group_exit = proc->PID == proc->TGID;
+
+        // the active thread goes last, below, since killing it switches away.
+        // the group's children are orphaned and won't stay zombies.
+        if (group_exit) {
+            for (uint8_t i = 0; i < MAX_PROCESS; i++){
+                process_struct* other = &proc_table[i];
+                if (other == proc || other->status == STOPPED) continue;
+                // nobody is left to wait for it
+                if (other->parent == PID) {
+                    other->parent = 0;
+                    release_process(other);
+                }
+                if (other->TGID != PID) continue;
+                // nobody is left to join it
+                release_process(other);
+                if (other->PID != active_pid) kill_process(other->PID);
+            }
+        }
+
+        // don't leave a dangling link in whatever queue it was blocked on, or
+        // a timer in the wheel pointing into the stack the reaper will free
+        if (proc->wait_link.next != NULL) list_remove(&proc->wait_link);
+        proc->wait_key = NULL;
+        cancel_timer(&proc->sleep_timer);
+
+        // close pipe ends handed to the process so the other side sees EOF.
+        // threads use their first thread's stdio, so only it closes them.
+        for (int i = 0; group_exit && i < 3; i++) {
+            if (proc->stdio[i] != i && proc->stdio[i] != -1) ramfs_close(proc->stdio[i]);
+        }
+
+        // give back any deadline reservation right away
+        proc->rt_runtime = 0;
+        proc->rt_budget = 0;
+
+        proc->status = ZOMBIE;
+        wake_queue(&proc->exit_waiters, (uint32_t)-1);
+        list_add_tail(&zombie_list, &proc->wait_link);
+        wake_queue(&reaper_queue, 1);
+
+        process_struct* active = get_process(active_pid);
+        if (group_exit && active != proc && active != NULL && active->TGID == PID) {
+            kill_process(active_pid);
+        }
+        if (PID == active_pid) switch_process_from_queue();
+    }
+
+    restore_interrupts(flags);
+}
+
+// purpose: gives up a zombie's exit status so its proc_table slot can be
+//          reused. the slot is freed now if the reaper is already done with
+//          it, otherwise by the reaper. call with interrupts disabled.
+// proc: the process nobody will collect the exit status of
+void release_process(process_struct* proc) {
+    proc->joinable = false;
+    if (proc->status == ZOMBIE && proc->context.stack_bottom == NULL) {
         proc->status = STOPPED;
+    }
+}
+
+// purpose: ends the active process, with every thread in it. its parent
+//          can collect status with waitpid(). never returns.
+// status: the exit status
+void exit_process(int status) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* proc = get_process(active_pid);
+    if (proc == NULL) {
+        restore_interrupts(flags);
+        return;
+    }
+
+    process_struct* leader = get_process(proc->TGID);
+    if (leader == NULL) leader = proc;
+    leader->exit_status = status;
+    kill_process(leader->PID);
+}
+
+// purpose: waits for a child process to exit and frees its slot. each child
+//          can be waited for once.
+// PID: the child to wait for
+// status: where to store its exit status. may be NULL
+// returns: PID on success, -1 if PID is not a child of the active process
+int wait_process(processID PID, int* status) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* self = get_process(active_pid);
+    process_struct* child = get_process(PID);
 
-        void* stack = proc->context.stack_bottom;
-        free(stack);
+    if (self == NULL || child == NULL || !child->joinable ||
+        child->parent == 0 || child->parent != self->TGID) {
+        restore_interrupts(flags);
+        return -1;
     }
+
+    while (child->status != ZOMBIE) {
+        if (wait_on_queue(&child->exit_waiters)) break;
+    }
+    // another thread of the parent waited for it first
+    if (child->PID != PID || child->status != ZOMBIE || !child->joinable) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    if (status) *status = child->exit_status;
+    child->parent = 0;
+    release_process(child);
+    restore_interrupts(flags);
+    return PID;
+}
+
+// purpose: body of the reaper process. sleeps until there are zombies, then
+//          takes all of them at once and frees their stacks and program
+//          images. a zombie is only queued once it can no longer run, and the
+//          reaper only runs once it has been switched away from, so its stack
+//          is never in use by the time it is freed.
+static void __reaper_main() {
+    list_header batch;
+
+    while (1) {
+        uint32_t flags = save_and_disable_interrupts();
+        while (is_end_of_list(&zombie_list)) wait_on_queue(&reaper_queue);
+
+        init_list(&batch);
+        while (!is_end_of_list(&zombie_list)) {
+            list_header* node = zombie_list.next;
+            list_remove(node);
+            list_add_tail(&batch, node);
+        }
+        restore_interrupts(flags);
+
+        while (!is_end_of_list(&batch)) {
+            process_struct* proc = container_of(batch.next, process_struct, wait_link);
+            list_remove(&proc->wait_link);
+
+            flags = save_and_disable_interrupts();
+            free(proc->context.stack_bottom);
+            proc->context.stack_bottom = NULL;
+            if (proc->image) free(proc->image);
+            proc->image = NULL;
+            if (proc->io_ring) free(proc->io_ring);
+            proc->io_ring = NULL;
+            // the leader goes last, so the whole process is gone
+            if (proc->PID == proc->TGID) {
+                munmap_process(proc->TGID);
+                shm_detach_process(proc->TGID);
+                release_process_brk(proc);
+            }
+            // a joinable thread stays a zombie until its exit status is taken
+            if (!proc->joinable) proc->status = STOPPED;
+            restore_interrupts(flags);
+        }
+    }
+}
+
+// purpose: starts the reaper process. call once, after the backstop has taken
+//          PID 0.
+void init_reaper() {
+    init_list(&zombie_list);
+    init_wait_queue(&reaper_queue);
+    init_process(&__reaper_main, allocate(REAPER_STACK_SIZE));
 }
 
 // purpose: sets up inital stack state for a new process. the new process is
@@ -77,14 +256,14 @@ void kill_process(processID PID) {
 // stack_top: a pointer to the highest valid address to use in new process' 
 //            stack
 // parent_PID: the PID of the parent process
-// returns: the PID of the newly created process
+// returns: the PID of the newly created process, or -1 if the table is full
 processID init_process(void* entry_point, void* stack_bottom) {
     processID PID = get_next_PID();
     process_struct* proc = reserve_proc_table_slot();
 
     if (proc == NULL) {
-        // TODO: actually handle the error
         terminal_writestring("CANNOT RESERVE PROCESS");
+        return (processID)-1;
     }
 
     block_header* blk = stack_bottom-sizeof(block_header);
@@ -121,9 +300,34 @@ processID init_process(void* entry_point, void* stack_bottom) {
 
     // set up the process_struct
     proc->PID = PID;
+    proc->TGID = PID;
+    proc->parent = 0;
     proc->status = SPAWNED;
     proc->entry_point = entry_point;
     proc->wait_time = 0;
+    init_list(&proc->wait_link);
+    proc->wait_key = NULL;
+    init_list(&proc->sleep_timer.list);
+    proc->image = NULL;
+    proc->io_ring = NULL;
+    init_list(&proc->brk_chunks);
+    proc->brk_start = proc->brk = proc->brk_limit = NULL;
+    proc->start_routine = NULL;
+    proc->start_arg = NULL;
+    proc->exit_status = 0;
+    proc->joinable = false;
+    init_wait_queue(&proc->exit_waiters);
+    proc->user_ticks = 0;
+    proc->kernel_ticks = 0;
+    proc->run_cycles = 0;
+    proc->switched_in = 0;
+    proc->switch_count = 0;
+    proc->last_run = 0;
+    proc->rt_runtime = 0;
+    proc->rt_deadline = 0;
+    proc->rt_period = 0;
+    proc->rt_budget = 0;
+    for (int i = 0; i < 3; i++) proc->stdio[i] = i;
 
     return PID;
 };
@@ -137,30 +341,346 @@ void switch_process(processID PID) {
     process_struct* new_proc = get_process(PID);
     
     if (new_proc != old_proc) {
+        uint64_t now = read_tsc();
+        if (old_proc != NULL) old_proc->run_cycles += now - old_proc->switched_in;
+        new_proc->switched_in = now;
+        new_proc->switch_count++;
+        new_proc->last_run = get_ticks();
+
         if (old_proc->status == ACTIVE) old_proc->status = WAITING;
         new_proc->status = ACTIVE;
         active_pid = PID;
+        vdso_set_active(new_proc->TGID, PID);
 
         context_switch(&old_proc->context, &new_proc->context);
     }
 }
 
 
+// purpose: checks whether a process may be picked by the scheduler
+// proc: the process to check
+// returns: true if the process can be given the CPU
+static bool __is_runnable(process_struct* proc) {
+    return proc->status == ACTIVE || proc->status == WAITING || proc->status == SPAWNED;
+}
+
+// purpose: finds the deadline process that should run now: the runnable one
+//          with budget left and the earliest deadline (EDF)
+// returns: the process, or NULL if no deadline process can run
+static process_struct* __pick_deadline_process() {
+    process_struct* best = NULL;
+
+    for (uint8_t i = 0; i < MAX_PROCESS; i++){
+        process_struct* proc = &proc_table[i];
+        if (!proc->rt_runtime || !proc->rt_budget || !__is_runnable(proc)) continue;
+        // compare as a signed difference so tick wraparound is harmless
+        if (best == NULL || (int32_t)(proc->rt_due - best->rt_due) < 0) {
+            best = proc;
+        }
+    }
+
+    return best;
+}
+
 // purpose: performs a context switch according to active scheduling algorithm. 
+//          deadline processes with budget left always go first. everything
+//          else shares what is left by longest wait. deadline processes that
+//          used up their budget sit out until their next period.
 void switch_process_from_queue() {
+    process_struct* rt_proc = __pick_deadline_process();
     process_struct* proc = get_process(0);
 
     for (uint8_t i = 0; i < MAX_PROCESS; i++){
-        if  (proc_table[i].status != STOPPED && proc_table[i].PID != 0) {
+        if  (__is_runnable(&proc_table[i]) && proc_table[i].PID != 0 && !proc_table[i].rt_runtime) {
             if (++proc_table[i].wait_time > proc->wait_time){
                 proc = &proc_table[i];
             }
         }
     }
 
+    if (rt_proc != NULL) proc = rt_proc;
     proc->wait_time = 0;
     if (proc->PID != active_pid) {
         switch_process(proc->PID);
 
     }
-}
\ No newline at end of file
+}
+
+// returns: the PID of the process currently on the CPU
+processID get_active_pid() {
+    return active_pid;
+}
+
+// purpose: takes the active process off the CPU until wake_process() is
+//          called on it. must be called with interrupts disabled, which
+//          closes the window between deciding to sleep and actually sleeping.
+void block_process() {
+    process_struct* proc = get_process(active_pid);
+    if (proc == NULL || proc->PID == 0) return;
+
+    proc->status = BLOCKED;
+    switch_process_from_queue();
+}
+
+// purpose: makes a blocked process schedulable again. safe to call from an
+//          interrupt handler.
+// PID: the PID to wake
+void wake_process(processID PID) {
+    process_struct* proc = get_process(PID);
+    if (proc != NULL && proc->status == BLOCKED) {
+        proc->status = WAITING;
+    }
+}
+
+static void __sleep_timer_callback(void* arg) {
+    wake_process((processID)arg);
+}
+
+// purpose: blocks the active process for at least the given number of ticks
+// ticks: how long to sleep
+void sleep_process(uint32_t ticks) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* proc = get_process(active_pid);
+    if (proc == NULL || proc->PID == 0) {
+        restore_interrupts(flags);
+        return;
+    }
+
+    // the timer lives in the process, not on its stack, so kill_process()
+    // can cancel it if the process dies while asleep
+    add_timer(&proc->sleep_timer, ticks, &__sleep_timer_callback, (void*)active_pid);
+    block_process();
+    // woken by someone else before the timer ran out
+    cancel_timer(&proc->sleep_timer);
+
+    restore_interrupts(flags);
+}
+
+// purpose: sets up an empty wait queue
+void init_wait_queue(wait_queue* queue) {
+    init_list(&queue->waiters);
+}
+
+// purpose: blocks the active process until wake_queue() picks it. must be
+//          called with interrupts disabled, after the caller has checked the
+//          condition it is waiting for.
+// queue: the queue to wait on
+// returns: 0 once woken, -1 if there is no process that can block (the
+//          backstop, or the kernel before scheduling starts)
+int wait_on_queue(wait_queue* queue) {
+    process_struct* proc = get_process(active_pid);
+    if (proc == NULL || proc->PID == 0) return -1;
+
+    list_add_tail(&queue->waiters, &proc->wait_link);
+    block_process();
+    // the waker normally unlinks us. this covers being woken some other way.
+    list_remove(&proc->wait_link);
+    return 0;
+}
+
+// purpose: wakes processes blocked on a queue in FIFO order. safe to call
+//          from an interrupt handler.
+// queue: the queue to wake
+// count: the maximum number of processes to wake. (uint32_t)-1 wakes all
+// returns: the number of processes woken
+uint32_t wake_queue(wait_queue* queue, uint32_t count) {
+    uint32_t woken = 0;
+    uint32_t flags = save_and_disable_interrupts();
+
+    while (woken < count && !is_end_of_list(&queue->waiters)) {
+        process_struct* proc = container_of(queue->waiters.next, process_struct, wait_link);
+        list_remove(&proc->wait_link);
+        wake_process(proc->PID);
+        woken++;
+    }
+
+    restore_interrupts(flags);
+    return woken;
+}
+
+// purpose: finds the first thread of the group a process belongs to, which
+//          holds the state all of the group's threads share
+// returns: the group's first thread, or NULL if PID is unknown
+static process_struct* __group_leader(processID PID) {
+    process_struct* proc = get_process(PID);
+    if (proc == NULL || proc->TGID == proc->PID) return proc;
+    return get_process(proc->TGID);
+}
+
+// purpose: translates one of a process' standard fds (0-2) to the fd_table
+//          entry it currently refers to
+// PID: the process to look up
+// stdio_fd: STDIN_FILENO, STDOUT_FILENO or STDERR_FILENO
+// returns: the fd_table index, -1 if the process closed it. any other fd, or
+//          an unknown process, is returned unchanged.
+int get_process_stdio(processID PID, int stdio_fd) {
+    process_struct* proc = __group_leader(PID);
+    if (proc == NULL || stdio_fd < 0 || stdio_fd > STDERR_FILENO) return stdio_fd;
+    return proc->stdio[stdio_fd];
+}
+
+// purpose: points one of a process' standard fds at another fd_table entry,
+//          such as the end of a pipe. the process takes ownership of fd and
+//          closes it when it exits.
+// PID: the process to change
+// stdio_fd: STDIN_FILENO, STDOUT_FILENO or STDERR_FILENO
+// fd: the fd_table index to use, or -1 to mark it closed
+// returns: 0 on success, -1 on failure
+int set_process_stdio(processID PID, int stdio_fd, int fd) {
+    process_struct* proc = __group_leader(PID);
+    if (proc == NULL || stdio_fd < 0 || stdio_fd > STDERR_FILENO) return -1;
+    proc->stdio[stdio_fd] = fd;
+    return 0;
+}
+
+// purpose: folds the current number of runnable processes into the load
+//          averages and re-arms itself. runs from the clock interrupt.
+static void __sample_load(void* arg) {
+    (void)arg;
+    static const uint32_t decay[3] = {LOAD_EXP_1, LOAD_EXP_5, LOAD_EXP_15};
+    uint32_t runnable = 0;
+
+    for (uint8_t i = 0; i < MAX_PROCESS; i++){
+        if (__is_runnable(&proc_table[i]) && proc_table[i].PID != 0) runnable++;
+    }
+
+    // load = load * e + runnable * (1 - e)
+    for (uint8_t i = 0; i < 3; i++) {
+        load_average[i] = (load_average[i] * decay[i] +
+                           runnable * LOAD_FIXED_1 * (LOAD_FIXED_1 - decay[i])) >> LOAD_FIXED_SHIFT;
+    }
+
+    add_timer(&load_timer, LOAD_SAMPLE_TICKS, &__sample_load, NULL);
+}
+
+// purpose: starts sampling the load average. call after init_timers().
+void init_process_accounting() {
+    add_timer(&load_timer, LOAD_SAMPLE_TICKS, &__sample_load, NULL);
+}
+
+// purpose: charges one clock tick to the active process. called from the
+//          clock interrupt before the scheduler runs.
+// eip: the instruction the tick interrupted. the kernel image counts as
+//      kernel time, anything else (a loaded ELF program) as user time.
+void account_process_tick(uint32_t eip) {
+    uint32_t now = get_ticks();
+
+    // start a new period for every deadline process that reached one
+    for (uint8_t i = 0; i < MAX_PROCESS; i++){
+        process_struct* rt = &proc_table[i];
+        if (rt->status != STOPPED && rt->rt_runtime && (int32_t)(now - rt->rt_replenish) >= 0) {
+            rt->rt_budget = rt->rt_runtime;
+            rt->rt_due = rt->rt_replenish + rt->rt_deadline;
+            rt->rt_replenish += rt->rt_period;
+        }
+    }
+
+    process_struct* proc = get_process(active_pid);
+    if (proc == NULL) return;
+    if (proc->rt_budget) proc->rt_budget--;
+
+    if (eip >= (uint32_t)kernel_start && eip < (uint32_t)kernel_end) {
+        proc->kernel_ticks++;
+    } else {
+        proc->user_ticks++;
+    }
+}
+
+// purpose: writes a number right aligned in a column
+static void __write_column(uint32_t num, uint8_t width) {
+    uint8_t digits = 1;
+    for (uint32_t n = num; n >= 10; n /= 10) digits++;
+    for (; digits < width; digits++) terminal_writestring(" ");
+    terminal_writeint(num);
+}
+
+// purpose: writes a load average as a number with two decimals
+static void __write_load(uint32_t load) {
+    uint32_t hundredths = ((load & (LOAD_FIXED_1 - 1)) * 100) >> LOAD_FIXED_SHIFT;
+    terminal_writeint(load >> LOAD_FIXED_SHIFT);
+    terminal_writestring(hundredths < 10 ? ".0" : ".");
+    terminal_writeint(hundredths);
+}
+
+// purpose: prints the load average and a line of accounting per process.
+//          %CPU is the share of all ticks since boot.
+void print_process_table() {
+    static const char* status_names[] = {"stop", "run ", "wait", "new ", "blck", "zomb"};
+    uint32_t now = get_ticks();
+
+    terminal_writestring("load average: ");
+    __write_load(load_average[0]);
+    terminal_writestring(" ");
+    __write_load(load_average[1]);
+    terminal_writestring(" ");
+    __write_load(load_average[2]);
+    terminal_writestring("\n  PID TGID STAT %CPU  USER  KERN  SWITCHES  MCYCLES  IDLE\n");
+
+    for (uint8_t i = 0; i < MAX_PROCESS; i++){
+        process_struct* proc = &proc_table[i];
+        if (proc->status == STOPPED) continue;
+
+        uint32_t ticks = proc->user_ticks + proc->kernel_ticks;
+        uint64_t cycles = proc->run_cycles;
+        if (proc->PID == active_pid) cycles += read_tsc() - proc->switched_in;
+
+        __write_column(proc->PID, 5);
+        __write_column(proc->TGID, 5);
+        terminal_writestring(" ");
+        terminal_writestring(status_names[proc->status]);
+        __write_column(now ? (ticks * 100) / now : 0, 5);
+        __write_column(proc->user_ticks, 6);
+        __write_column(proc->kernel_ticks, 6);
+        __write_column(proc->switch_count, 10);
+        __write_column((uint32_t)(cycles >> 20), 9);
+        __write_column(now - proc->last_run, 6);
+        terminal_writestring("\n");
+    }
+}
+
+// purpose: moves a process into the deadline class, or back out of it. the
+//          process is then guaranteed runtime ticks of CPU within deadline
+//          ticks of the start of every period, ahead of all normal processes.
+//          a request is refused if it would push the total reserved
+//          utilization over RT_MAX_UTILIZATION.
+// PID: the process to change
+// runtime: ticks of CPU per period. 0 returns the process to normal scheduling
+// deadline: ticks after each period starts that the runtime must be done by
+// period: ticks between the starts of periods
+// returns: 0 on success, -1 if the parameters are invalid or not admitted
+int set_process_deadline(processID PID, uint32_t runtime, uint32_t deadline, uint32_t period) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* proc = get_process(PID);
+
+    if (proc == NULL || proc->PID == 0 ||
+        (runtime && (runtime > deadline || deadline > period))) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    // admission control. runtime / deadline is the density of a task, which
+    // is a safe bound for EDF when deadlines may be shorter than periods.
+    uint32_t reserved = runtime ? (runtime << RT_UTILIZATION_SHIFT) / deadline : 0;
+    for (uint8_t i = 0; i < MAX_PROCESS; i++){
+        process_struct* rt = &proc_table[i];
+        if (rt != proc && rt->status != STOPPED && rt->rt_runtime) {
+            reserved += (rt->rt_runtime << RT_UTILIZATION_SHIFT) / rt->rt_deadline;
+        }
+    }
+    if (reserved > RT_MAX_UTILIZATION) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    // the first period starts now
+    uint32_t now = get_ticks();
+    proc->rt_runtime = runtime;
+    proc->rt_deadline = deadline;
+    proc->rt_period = period;
+    proc->rt_budget = runtime;
+    proc->rt_due = now + deadline;
+    proc->rt_replenish = now + period;
+
+    restore_interrupts(flags);
+    return 0;
+}
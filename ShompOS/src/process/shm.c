@@ -0,0 +1,238 @@
+// shm.c
+// Named shared memory regions for inter-process communication
+// Cedarville University 2024-25 OSDev Team
+
+#include <process/shm.h>
+#include <kernel/boot.h>
+#include <memory/heap.h>
+#include <string.h>
+
+static shm_region shm_table[MAX_SHM_REGIONS];
+
+// purpose: looks up a region id and checks that it is live
+// returns: a pointer to the region, or NULL if id is invalid
+static shm_region* __shm_get(int id) {
+    if (id < 0 || id >= MAX_SHM_REGIONS || !shm_table[id].in_use) return NULL;
+    return &shm_table[id];
+}
+
+// purpose: finds the process (thread group) the caller belongs to, which is
+//          what attaches to a region
+// returns: its TGID, or -1 if there is no active process
+static processID __shm_caller() {
+    process_struct* proc = get_process(get_active_pid());
+    return proc ? proc->TGID : (processID)-1;
+}
+
+// purpose: finds a process in a region's attachments
+// returns: its index in attached, or -1 if it isn't attached
+static int __shm_find_attached(shm_region* region, processID tgid) {
+    for (uint32_t i = 0; i < region->attach_count; i++) {
+        if (region->attached[i] == tgid) return i;
+    }
+    return -1;
+}
+
+// purpose: frees a region once nobody is attached and nobody can attach
+//          again: it was unlinked or its owner is gone. call with interrupts
+//          disabled.
+static void __shm_free_if_unused(shm_region* region) {
+    if (region->attach_count || (!region->unlinked && region->owner != SHM_NO_OWNER)) return;
+
+    // nobody can be waiting on a region nobody has mapped, but don't strand
+    // anyone who raced us here
+    wake_queue(&region->waiters, (uint32_t)-1);
+    free(region->base);
+    region->in_use = false;
+}
+
+// purpose: drops one attachment, freeing the region if it was the last one
+//          and the region is unused. call with interrupts disabled.
+// index: the attachment's index in attached
+static void __shm_drop(shm_region* region, int index) {
+    region->attached[index] = region->attached[--region->attach_count];
+    __shm_free_if_unused(region);
+}
+
+// purpose: opens the region with the given name, creating it if it does not
+//          exist yet. a new region is zeroed and owned by its creator's
+//          process. unlinked regions no longer answer to their name.
+// name: up to SHM_NAME_LEN-1 characters
+// size: the size in bytes. when opening an existing region it must not be
+//       larger than the region
+// returns: the region id, or -1 on failure
+int shm_create(const char* name, size_t size) {
+    if (!name || !*name || strlen(name) >= SHM_NAME_LEN || !size) return -1;
+
+    uint32_t flags = save_and_disable_interrupts();
+    int id = -1;
+    int free_id = -1;
+
+    for (int i = 0; i < MAX_SHM_REGIONS; i++) {
+        if (!shm_table[i].in_use) {
+            if (free_id == -1) free_id = i;
+        } else if (!shm_table[i].unlinked && strcmp(shm_table[i].name, name) == 0) {
+            id = (size <= shm_table[i].size) ? i : -1;
+            restore_interrupts(flags);
+            return id;
+        }
+    }
+
+    if (free_id != -1) {
+        void* base = allocate(size);
+        if (base) {
+            shm_region* region = &shm_table[free_id];
+            memset(base, 0, size);
+            strcpy(region->name, name);
+            region->base = base;
+            region->size = size;
+            region->attach_count = 0;
+            region->owner = __shm_caller();
+            region->unlinked = false;
+            region->sequence = 0;
+            init_wait_queue(&region->waiters);
+            region->in_use = true;
+            id = free_id;
+        }
+    }
+
+    restore_interrupts(flags);
+    return id;
+}
+
+// purpose: maps a region into the calling process. attaching again while
+//          already attached just returns the address
+// id: the region id from shm_create()
+// returns: the address of the region, or NULL if id is invalid or
+//          MAX_SHM_ATTACH processes are attached already
+void* shm_attach(int id) {
+    processID caller = __shm_caller();
+    uint32_t flags = save_and_disable_interrupts();
+    shm_region* region = __shm_get(id);
+    void* base = NULL;
+
+    if (region && __shm_find_attached(region, caller) != -1) {
+        base = region->base;
+    } else if (region && region->attach_count < MAX_SHM_ATTACH) {
+        region->attached[region->attach_count++] = caller;
+        base = region->base;
+    }
+
+    restore_interrupts(flags);
+    return base;
+}
+
+// purpose: unmaps a region from the calling process. the memory is released
+//          once the last process detaches, if the region was unlinked or its
+//          owner exited.
+// id: the region id from shm_create()
+// returns: 0 on success, -1 if id is invalid or the caller isn't attached
+int shm_detach(int id) {
+    processID caller = __shm_caller();
+    uint32_t flags = save_and_disable_interrupts();
+    shm_region* region = __shm_get(id);
+    int index = region ? __shm_find_attached(region, caller) : -1;
+
+    if (index != -1) __shm_drop(region, index);
+
+    restore_interrupts(flags);
+    return index != -1 ? 0 : -1;
+}
+
+// purpose: detaches a process from every region it is still attached to, and
+//          gives up the regions it owns. called once it exits
+// tgid: the TGID of the process
+void shm_detach_process(processID tgid) {
+    uint32_t flags = save_and_disable_interrupts();
+    for (int i = 0; i < MAX_SHM_REGIONS; i++) {
+        shm_region* region = &shm_table[i];
+        if (!region->in_use) continue;
+        if (region->owner == tgid) region->owner = SHM_NO_OWNER;
+
+        int index = __shm_find_attached(region, tgid);
+        if (index != -1) __shm_drop(region, index);
+        else __shm_free_if_unused(region);
+    }
+    restore_interrupts(flags);
+}
+
+// purpose: hands the contents of a region to another process without copying
+//          them and wakes anyone waiting on it. only the current owner may
+//          give the region away, and only to a live process attached to it.
+// id: the region id from shm_create()
+// new_owner: the TGID that takes ownership
+// returns: 0 on success, -1 on failure
+int shm_transfer(int id, processID new_owner) {
+    processID caller = __shm_caller();
+    uint32_t flags = save_and_disable_interrupts();
+    shm_region* region = __shm_get(id);
+    process_struct* target = get_process(new_owner);
+
+    if (!region || region->owner != caller || !target || target->TGID != new_owner ||
+        target->status == ZOMBIE || __shm_find_attached(region, new_owner) == -1) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    region->owner = new_owner;
+    shm_notify(id);
+    restore_interrupts(flags);
+    return 0;
+}
+
+// purpose: removes a region's name, so shm_create() makes a new region
+//          instead of opening it. the memory is released once the last
+//          process detaches. only the owner may unlink a region.
+// id: the region id from shm_create()
+// returns: 0 on success, -1 on failure
+int shm_unlink(int id) {
+    processID caller = __shm_caller();
+    uint32_t flags = save_and_disable_interrupts();
+    shm_region* region = __shm_get(id);
+
+    if (!region || region->unlinked || region->owner != caller) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    region->unlinked = true;
+    __shm_free_if_unused(region);
+    restore_interrupts(flags);
+    return 0;
+}
+
+// purpose: signals that a region's contents changed and wakes every process
+//          blocked in shm_wait() on it
+// id: the region id from shm_create()
+// returns: the new sequence number
+uint32_t shm_notify(int id) {
+    shm_region* region = __shm_get(id);
+    if (!region) return 0;
+
+    uint32_t flags = save_and_disable_interrupts();
+    uint32_t sequence = ++region->sequence;
+    wake_queue(&region->waiters, (uint32_t)-1);
+    restore_interrupts(flags);
+
+    return sequence;
+}
+
+// purpose: blocks until the region is notified past a known sequence number.
+//          returns immediately if that already happened, so a notify that
+//          lands between reading the data and calling shm_wait() is not lost.
+// id: the region id from shm_create()
+// seen_sequence: the last sequence number the caller has handled
+// returns: the current sequence number
+uint32_t shm_wait(int id, uint32_t seen_sequence) {
+    uint32_t flags = save_and_disable_interrupts();
+    shm_region* region = __shm_get(id);
+
+    while (region && region->sequence == seen_sequence) {
+        if (wait_on_queue(&region->waiters)) break;
+        region = __shm_get(id);
+    }
+
+    uint32_t sequence = region ? region->sequence : 0;
+    restore_interrupts(flags);
+    return sequence;
+}
@@ -0,0 +1,77 @@
+// thread.c
+// User threads: extra schedulable contexts inside one process
+// Cedarville University 2024-25 OSDev Team
+
+// a thread is a proc_table entry with its own PID (used as the TID), stack
+// and context, whose TGID names the thread that started the program. there
+// is no paging, so memory is shared already. stdio lives in the first thread
+// and the others look it up through the TGID (see get_process_stdio()).
+
+#include <process/thread.h>
+#include <kernel/boot.h>
+#include <memory/heap.h>
+
+// purpose: first code a thread runs. keeps what the start routine returns
+//          for thread_join(). returning from here lands in kill_process.
+static void __thread_trampoline() {
+    process_struct* proc = get_process(get_active_pid());
+    proc->exit_status = ((thread_fn)proc->start_routine)(proc->start_arg);
+}
+
+// purpose: starts a new thread in the calling process. it starts on the next
+//          tick, like any process.
+// fn: the start routine. the thread exits when it returns
+// arg: passed to fn
+// returns: the TID of the new thread, or -1 on failure
+processID thread_create(thread_fn fn, void* arg) {
+    void* stack = allocate(THREAD_STACK_SIZE);
+    if (!stack) return -1;
+
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* caller = get_process(get_active_pid());
+    processID tid = caller ? init_process(&__thread_trampoline, stack) : (processID)-1;
+    process_struct* proc = get_process(tid);
+    if (proc == NULL) {
+        restore_interrupts(flags);
+        free(stack);
+        return -1;
+    }
+    proc->TGID = caller->TGID;
+    proc->start_routine = fn;
+    proc->start_arg = arg;
+    proc->joinable = true;
+    restore_interrupts(flags);
+
+    return tid;
+}
+
+// purpose: waits for another thread of the same process to exit and frees
+//          its slot. each thread can be joined once.
+// TID: the thread to wait for
+// status: where to store what its start routine returned. may be NULL
+// returns: 0 on success, -1 if TID is not a joinable thread of this process
+int thread_join(processID TID, int* status) {
+    uint32_t flags = save_and_disable_interrupts();
+    process_struct* self = get_process(get_active_pid());
+    process_struct* thread = get_process(TID);
+
+    if (self == NULL || thread == NULL || thread == self ||
+        !thread->joinable || thread->TGID != self->TGID) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    while (thread->status != ZOMBIE) {
+        if (wait_on_queue(&thread->exit_waiters)) break;
+    }
+    // someone else joined it first
+    if (thread->PID != TID || thread->status != ZOMBIE || !thread->joinable) {
+        restore_interrupts(flags);
+        return -1;
+    }
+
+    if (status) *status = thread->exit_status;
+    release_process(thread);
+    restore_interrupts(flags);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// syscall_trace.c
+// Optional per-syscall counters, latency histograms and a log of recent calls
+// Cedarville University 2024-25 OSDev Team
+
+#include <syscalls/syscall_trace.h>
+#include <kernel/kernel.h>
+#include <kernel/boot.h>
+#include <memory/heap.h>
+#include <string.h>
+#include <syscall_spec.h>
+
+// tested by the dispatchers in boot.S before every call
+volatile uint32_t syscall_trace_flags = 0;
+// only calls from this process are recorded. 0 records everyone
+static processID trace_tgid = 0;
+
+static syscall_stats stats_table[SYSCALL_TABLE_SIZE];
+static syscall_event event_log[SYSCALL_LOG_SIZE];
+static uint32_t event_count = 0;
+
+#define SYSCALL(num, name, ...) [num] = #name,
+static const char* syscall_names[SYSCALL_TABLE_SIZE] = {
+    SYSCALL_LIST(SYSCALL)
+};
+#undef SYSCALL
+
+// see syscalls.c. handlers are called the way boot.S calls them: with all
+// six registers, whatever they actually take
+typedef void (*syscall_fn)(void);
+typedef uint32_t (*syscall_call)(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t);
+extern const syscall_fn sys_table[SYSCALL_TABLE_SIZE];
+
+// purpose: turns tracing on or off
+// flags: SYSCALL_TRACE_STATS and/or SYSCALL_TRACE_LOG, 0 to stop
+// TGID: the process to trace, 0 for all of them
+void set_syscall_trace(uint32_t flags, processID TGID) {
+    uint32_t eflags = save_and_disable_interrupts();
+    trace_tgid = TGID;
+    syscall_trace_flags = flags;
+    restore_interrupts(eflags);
+}
+
+// purpose: forgets everything recorded so far
+void clear_syscall_trace() {
+    uint32_t eflags = save_and_disable_interrupts();
+    memset(stats_table, 0, sizeof(stats_table));
+    memset(event_log, 0, sizeof(event_log));
+    event_count = 0;
+    restore_interrupts(eflags);
+}
+
+// purpose: runs a syscall and records it. boot.S calls this instead of the
+//          handler while tracing is on, after checking the number is valid.
+//          runs with interrupts disabled, except while the handler blocks
+// number: the syscall number
+// returns: what the handler returned
+uint32_t syscall_traced(uint32_t number, uint32_t ebx, uint32_t ecx, uint32_t edx, uint32_t esi, uint32_t edi, uint32_t ebp) {
+    processID pid = get_active_pid();
+    process_struct* proc = get_process(pid);
+    if (trace_tgid && (!proc || proc->TGID != trace_tgid)) {
+        return ((syscall_call)sys_table[number])(ebx, ecx, edx, esi, edi, ebp);
+    }
+
+    // take a log slot before the call, so calls that block or never
+    // return still show up in order
+    uint32_t flags = syscall_trace_flags;
+    syscall_event* event = NULL;
+    uint32_t sequence = 0;
+    if (flags & SYSCALL_TRACE_LOG) {
+        sequence = ++event_count;
+        event = &event_log[sequence % SYSCALL_LOG_SIZE];
+        event->sequence = sequence;
+        event->PID = pid;
+        event->number = number;
+        event->args[0] = ebx;
+        event->args[1] = ecx;
+        event->args[2] = edx;
+        event->done = false;
+    }
+
+    uint64_t start = read_tsc();
+    uint32_t result = ((syscall_call)sys_table[number])(ebx, ecx, edx, esi, edi, ebp);
+    uint32_t cycles = (uint32_t)(read_tsc() - start);
+
+    if (flags & SYSCALL_TRACE_STATS) {
+        syscall_stats* stats = &stats_table[number];
+        uint32_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+        if (bucket >= SYSCALL_HIST_BUCKETS) bucket = SYSCALL_HIST_BUCKETS - 1;
+        stats->count++;
+        stats->total_cycles += cycles;
+        stats->histogram[bucket]++;
+    }
+
+    // a long block may have let the log wrap onto our slot
+    if (event && event->sequence == sequence) {
+        event->result = result;
+        event->cycles = cycles;
+        event->done = true;
+    }
+
+    return result;
+}
+
+// purpose: writes a syscall's name, or its number if it has none
+static void __write_syscall_name(uint32_t number) {
+    if (number < SYSCALL_TABLE_SIZE && syscall_names[number]) {
+        terminal_writestring(syscall_names[number]);
+    } else {
+        terminal_writeint(number);
+    }
+}
+
+// purpose: prints each syscall that has been called with its count, average
+//          cycles and the non-empty buckets of its histogram as 2^n:count
+void print_syscall_stats() {
+    terminal_writestring("SYSCALL  COUNT  AVG CYCLES  HISTOGRAM\n");
+    for (uint32_t i = 0; i < SYSCALL_TABLE_SIZE; i++) {
+        syscall_stats* stats = &stats_table[i];
+        if (!stats->count) continue;
+
+        // no 64-bit divide without libgcc, see print_irq_stats()
+        uint64_t total = stats->total_cycles;
+        uint32_t count = stats->count;
+        while (total >> 32) {
+            total >>= 1;
+            count >>= 1;
+        }
+
+        __write_syscall_name(i);
+        terminal_writestring("  ");
+        terminal_writeint(stats->count);
+        terminal_writestring("  ");
+        terminal_writeint(count ? (uint32_t)total / count : 0);
+        terminal_writestring(" ");
+        for (uint32_t bucket = 0; bucket < SYSCALL_HIST_BUCKETS; bucket++) {
+            if (!stats->histogram[bucket]) continue;
+            terminal_writestring(" 2^");
+            terminal_writeint(bucket);
+            terminal_writestring(":");
+            terminal_writeint(stats->histogram[bucket]);
+        }
+        terminal_writestring("\n");
+    }
+}
+
+// purpose: prints the most recent calls, oldest first, as
+//          PID name(arg, arg, arg) = result  cycles
+void print_syscall_log() {
+    char buf[12];
+    uint32_t first = event_count > SYSCALL_LOG_SHOWN ? event_count - SYSCALL_LOG_SHOWN + 1 : 1;
+
+    for (uint32_t sequence = first; sequence <= event_count; sequence++) {
+        syscall_event* event = &event_log[sequence % SYSCALL_LOG_SIZE];
+        if (event->sequence != sequence) continue;
+
+        terminal_writeint(event->PID);
+        terminal_writestring(" ");
+        __write_syscall_name(event->number);
+        terminal_writestring("(");
+        for (uint8_t i = 0; i < 3; i++) {
+            if (i) terminal_writestring(", ");
+            terminal_writestring(addr_to_string(buf, event->args[i]));
+        }
+        if (event->done) {
+            terminal_writestring(") = ");
+            terminal_writeint((int32_t)event->result);
+            terminal_writestring("  ");
+            terminal_writeint(event->cycles);
+            terminal_writestring("\n");
+        } else {
+            terminal_writestring(") ...\n");
+        }
+    }
+}
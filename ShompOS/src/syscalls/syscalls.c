@@ -3,10 +3,316 @@
 // Cedarville University 2024-25 OSDev Team
 
 #include <kernel.h>
+#include <process/shm.h>
+#include <process/process.h>
+#include <process/futex.h>
+#include <process/thread.h>
+#include <process/brk.h>
+#include <fs/ramfs.h>
+#include <fs/mmap.h>
+#include <kernel/boot.h>
+#include <kernel/timer.h>
+#include <kernel/vdso_page.h>
+#include <memory/heap.h>
+#include <elf.h>
+#include <string.h>
+#include <io_ring.h>
+#include <syscall_spec.h>
 
+// longest path a program may pass in, including the terminator
+#define SYSCALL_PATH_MAX 128
+
+// ----- user pointers -----
+// there is no paging, so a program's memory is whatever it was given from
+// the heap: its image, its stack and anything it allocated. anything else,
+// like the kernel image, is refused. arguments the kernel keeps looking at
+// (paths, argv) are copied in once up front, so a program can't change them
+// halfway through a syscall.
+
+// purpose: checks a buffer a program passed in
+// returns: true if all size bytes belong to the heap
+static bool __user_buffer_ok(const void* ptr, size_t size) {
+    return ptr != NULL && heap_contains(ptr, size ? size : 1);
+}
+
+// purpose: copies a NUL terminated string from a program into a kernel buffer
+// dest: the kernel buffer
+// src: the program's string
+// size: the size of dest
+// returns: 0 on success, -1 if src is invalid or doesn't fit
+static int __copy_string_from_user(char* dest, const char* src, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (!__user_buffer_ok(&src[i], 1)) return -1;
+        dest[i] = src[i];
+        if (dest[i] == '\0') return 0;
+    }
+    return -1;
+}
+
+// ----- processes -----
 void syscall_exit(int error_code) {
-    terminal_writestring("exiting!");
-    char myString[2] = { (char)error_code + '0', '\0' };
-    terminal_writestring(myString);
+    exit_process(error_code);
+}
+
+// starts the program at path, relative to the root, as a child of the caller
+processID syscall_spawn(const char* path, char* const argv[]) {
+    char kpath[SYSCALL_PATH_MAX];
+    if (__copy_string_from_user(kpath, path, sizeof(kpath))) return -1;
+
+    // copy argv into one buffer. init_elf copies it again onto the new
+    // stack, but by then it can no longer change under us.
+    char strings[ELF_MAX_ARG_BYTES];
+    char* kargv[ELF_MAX_ARGS + 1];
+    size_t used = 0;
+    int argc = 0;
+    for (; argv; argc++) {
+        if (!__user_buffer_ok(&argv[argc], sizeof(char*))) return -1;
+        if (argv[argc] == NULL) break;
+        if (argc == ELF_MAX_ARGS) return -1;
+        if (__copy_string_from_user(&strings[used], argv[argc], sizeof(strings) - used)) return -1;
+        kargv[argc] = &strings[used];
+        used += strlen(kargv[argc]) + 1;
+    }
+    kargv[argc] = NULL;
+
+    ramfs_file_t* file = ramfs_find_file(system_root, kpath);
+    if (!file) return -1;
+
+    uint32_t flags = save_and_disable_interrupts();
+    processID pid = init_elf(file, kargv);
+    process_struct* child = get_process(pid);
+    process_struct* self = get_process(get_active_pid());
+    if (child && self) {
+        // keep its exit status around until the caller waits for it
+        child->parent = self->TGID;
+        child->joinable = true;
+    }
+    restore_interrupts(flags);
+
+    return pid;
+}
+
+// options are accepted for compatibility. waiting always blocks.
+processID syscall_waitpid(processID pid, int* status, int options) {
+    (void)options;
+    if (status && !__user_buffer_ok(status, sizeof(int))) return -1;
+    return wait_process(pid, status);
+}
+
+// a process is its group of threads. its PID is the TID of its first thread.
+processID syscall_getpid() {
+    process_struct* proc = get_process(get_active_pid());
+    return proc ? proc->TGID : (processID)-1;
+}
+
+int syscall_yield() {
+    switch_process_from_queue();
     return 0;
-}
\ No newline at end of file
+}
+
+int syscall_msleep(uint32_t ms) {
+    sleep_process(MS_TO_TICKS(ms));
+    return 0;
+}
+
+// the page is the same for every process. programs fetch it once and then
+// read the time and their ids from it directly.
+const vdso_data* syscall_vdso_address() {
+    return &vdso_page_data;
+}
+
+// ----- file descriptors -----
+// fds 0-2 are per process. a process started in a pipeline has them pointed
+// at pipe ends instead of the terminal.
+ssize_t syscall_read(int fd, void* buf, size_t count) {
+    if (!__user_buffer_ok(buf, count)) return -1;
+    return ramfs_read(get_process_stdio(get_active_pid(), fd), buf, count);
+}
+
+ssize_t syscall_write(int fd, const void* buf, size_t count) {
+    if (!__user_buffer_ok(buf, count)) return -1;
+    return ramfs_write(get_process_stdio(get_active_pid(), fd), buf, count);
+}
+
+// mode is accepted for compatibility. ramfs has no permissions.
+int syscall_open(const char* filename, int flags, uint32_t mode) {
+    (void)mode;
+    char kpath[SYSCALL_PATH_MAX];
+    if (__copy_string_from_user(kpath, filename, sizeof(kpath))) return -1;
+    return ramfs_open(system_root, kpath, flags);
+}
+
+int syscall_close(int fd) {
+    if (fd > STDERR_FILENO) return ramfs_close(fd);
+
+    // never close the terminal itself, only what the process was handed
+    processID pid = get_active_pid();
+    int target = get_process_stdio(pid, fd);
+    if (target == -1) return -1;
+    if (target != fd) ramfs_close(target);
+    return set_process_stdio(pid, fd, -1);
+}
+
+off_t syscall_lseek(int fd, off_t offset, int whence) {
+    return ramfs_seek(get_process_stdio(get_active_pid(), fd), offset, whence);
+}
+
+// ----- memory mapping -----
+void* syscall_mmap(int fd, size_t offset, size_t len, int prot) {
+    return mmap_file(get_process_stdio(get_active_pid(), fd), offset, len, prot);
+}
+
+int syscall_munmap(void* addr, size_t len) {
+    return munmap_region(addr, len);
+}
+
+// ----- program break -----
+int syscall_brk(void* addr) {
+    return process_brk(get_active_pid(), addr);
+}
+
+void* syscall_sbrk(int32_t increment) {
+    return process_sbrk(get_active_pid(), increment);
+}
+
+// ----- batched I/O -----
+// each process can have one io_ring. the kernel owns its memory, which lies
+// in the heap like the rest of the program's, and frees it when the process
+// exits. entries run in order through the syscalls above, so they get the
+// same checks, and one trap covers the whole batch.
+
+io_ring* syscall_io_ring_setup() {
+    process_struct* proc = get_process(get_active_pid());
+    if (!proc) return NULL;
+
+    if (!proc->io_ring) {
+        proc->io_ring = allocate(sizeof(io_ring));
+        if (proc->io_ring) memset(proc->io_ring, 0, sizeof(io_ring));
+    }
+    return proc->io_ring;
+}
+
+// purpose: runs one submission entry
+// returns: what the matching syscall returns, -1 for an unknown op
+static int32_t __io_ring_run(const io_sqe* sqe) {
+    switch (sqe->op) {
+        case IO_OP_NOP:
+            return 0;
+        case IO_OP_READ:
+            return syscall_read(sqe->fd, (void*)sqe->addr, sqe->len);
+        case IO_OP_WRITE:
+            return syscall_write(sqe->fd, (const void*)sqe->addr, sqe->len);
+        case IO_OP_OPEN:
+            return syscall_open((const char*)sqe->addr, sqe->len, 0);
+        case IO_OP_CLOSE:
+            return syscall_close(sqe->fd);
+        default:
+            return -1;
+    }
+}
+
+// runs every queued entry, stopping early only if the completion ring fills.
+// an entry that blocks, like a read from an empty pipe, holds up the ones
+// behind it. returns the number of entries consumed.
+int syscall_io_ring_enter() {
+    process_struct* proc = get_process(get_active_pid());
+    io_ring* ring = proc ? proc->io_ring : NULL;
+    if (!ring) return -1;
+
+    int consumed = 0;
+    uint32_t head = ring->sq_head;
+    while (head != __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE)) {
+        if (ring->cq_tail - __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE) >= IO_RING_ENTRIES) break;
+
+        // copy the entry first so the program can't change it mid-operation
+        io_sqe sqe = ring->sqes[head & IO_RING_MASK];
+        io_cqe* cqe = &ring->cqes[ring->cq_tail & IO_RING_MASK];
+        cqe->user_data = sqe.user_data;
+        cqe->result = __io_ring_run(&sqe);
+
+        __atomic_store_n(&ring->cq_tail, ring->cq_tail + 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&ring->sq_head, ++head, __ATOMIC_RELEASE);
+        consumed++;
+    }
+
+    return consumed;
+}
+
+// ----- shared memory -----
+int syscall_shm_create(const char* name, size_t size) {
+    char kname[SHM_NAME_LEN];
+    if (__copy_string_from_user(kname, name, sizeof(kname))) return -1;
+    return shm_create(kname, size);
+}
+
+void* syscall_shm_attach(int id) {
+    return shm_attach(id);
+}
+
+int syscall_shm_detach(int id) {
+    return shm_detach(id);
+}
+
+int syscall_shm_transfer(int id, processID new_owner) {
+    return shm_transfer(id, new_owner);
+}
+
+int syscall_shm_unlink(int id) {
+    return shm_unlink(id);
+}
+
+uint32_t syscall_shm_notify(int id) {
+    return shm_notify(id);
+}
+
+uint32_t syscall_shm_wait(int id, uint32_t seen_sequence) {
+    return shm_wait(id, seen_sequence);
+}
+
+// ----- futex -----
+int syscall_futex(volatile uint32_t* addr, int op, uint32_t val, uint32_t timeout_ticks) {
+    if (!__user_buffer_ok((const void*)addr, sizeof(uint32_t))) return -1;
+
+    switch (op) {
+        case FUTEX_WAIT:
+            return futex_wait(addr, val, timeout_ticks);
+        case FUTEX_WAKE:
+            return futex_wake(addr, val);
+        default:
+            return -1;
+    }
+}
+
+// ----- threads -----
+processID syscall_gettid() {
+    return get_active_pid();
+}
+
+processID syscall_thread_create(thread_fn fn, void* arg) {
+    if (!__user_buffer_ok((const void*)fn, 1)) return -1;
+    return thread_create(fn, arg);
+}
+
+int syscall_thread_join(processID tid, int* status) {
+    if (status && !__user_buffer_ok(status, sizeof(int))) return -1;
+    return thread_join(tid, status);
+}
+
+// ----- scheduling -----
+// PID 0 means the caller, as on Linux. PID 0 itself is the backstop and can
+// never be a deadline process anyway.
+int syscall_sched_setattr(processID pid, uint32_t runtime, uint32_t deadline, uint32_t period) {
+    if (pid == 0) pid = get_active_pid();
+    return set_process_deadline(pid, runtime, deadline, period);
+}
+
+// ----- table -----
+// the handlers take different arguments, so the table stores them all as one
+// type. the dispatchers in boot.S pass every handler the same six registers.
+typedef void (*syscall_fn)(void);
+
+#define SYSCALL(num, name, ...) [num] = (syscall_fn)&syscall_##name,
+const syscall_fn sys_table[SYSCALL_TABLE_SIZE] = {
+    SYSCALL_LIST(SYSCALL)
+};
+#undef SYSCALL
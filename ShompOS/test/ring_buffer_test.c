@@ -0,0 +1,191 @@
+// ring_buffer_test.c
+// Host-side stress test for the lock-free rings in src/fake_libc
+// Cedarville University 2024-25 OSDev Team
+
+// built with the host compiler and pthreads by `make test`. threads stand in
+// for interrupt handlers and processes: several push into one MPSC ring while
+// the main thread pops, then one thread feeds an SPSC ring. every item
+// carries its producer and a sequence number, so a lost, duplicated, torn or
+// reordered item fails the test. a side that finds the ring full or empty
+// yields, so the test also finishes quickly on a single core.
+
+#include <fake_libc/ring_buffer.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#define ITEMS_PER_PRODUCER 200000
+#define PRODUCERS 4
+#define MPSC_CAPACITY 64
+#define SPSC_CAPACITY 16
+
+typedef struct {
+    uint32_t producer;
+    uint32_t sequence;
+    uint32_t check;         // producer ^ sequence, to catch torn copies
+} test_item;
+
+static mpsc_ring_buffer mpsc;
+static uint8_t mpsc_storage[MPSC_RING_STORAGE_SIZE(sizeof(test_item), MPSC_CAPACITY)];
+static ring_buffer spsc;
+static uint8_t spsc_storage[RING_STORAGE_SIZE(sizeof(test_item), SPSC_CAPACITY)];
+
+static int failures = 0;
+static uint32_t producers_done = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// purpose: pushes ITEMS_PER_PRODUCER items into the MPSC ring, retrying
+//          while it is full
+static void* mpsc_producer(void* arg) {
+    uint32_t producer = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        test_item item = {producer, i, producer ^ i};
+        while (!mpsc_ring_push(&mpsc, &item)) sched_yield();
+    }
+    __atomic_add_fetch(&producers_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// purpose: pushes ITEMS_PER_PRODUCER items into the SPSC ring
+static void* spsc_producer(void* arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        test_item item = {0, i, i};
+        while (!ring_push(&spsc, &item)) sched_yield();
+    }
+    __atomic_add_fetch(&producers_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// purpose: checks the edge cases on one thread: empty, full and wrapping
+static void test_single_thread() {
+    test_item item;
+
+    ring_init(&spsc, spsc_storage, sizeof(test_item), SPSC_CAPACITY);
+    CHECK(ring_empty(&spsc), "new ring not empty");
+    CHECK(!ring_pop(&spsc, &item), "popped from an empty ring");
+
+    // go around several times so the indices wrap the storage
+    for (uint32_t lap = 0; lap < 5; lap++) {
+        for (uint32_t i = 0; i < SPSC_CAPACITY; i++) {
+            test_item in = {lap, i, lap ^ i};
+            CHECK(ring_push(&spsc, &in), "push %u failed before full", i);
+        }
+        test_item extra = {0, 0, 0};
+        CHECK(!ring_push(&spsc, &extra), "pushed into a full ring");
+        CHECK(ring_count(&spsc) == SPSC_CAPACITY, "count %u when full", ring_count(&spsc));
+
+        for (uint32_t i = 0; i < SPSC_CAPACITY; i++) {
+            CHECK(ring_pop(&spsc, &item) && item.producer == lap && item.sequence == i,
+                  "lap %u item %u came out wrong", lap, i);
+        }
+        CHECK(ring_empty(&spsc), "ring not empty after draining");
+    }
+
+    mpsc_ring_init(&mpsc, mpsc_storage, sizeof(test_item), MPSC_CAPACITY);
+    CHECK(mpsc_ring_empty(&mpsc), "new MPSC ring not empty");
+    for (uint32_t lap = 0; lap < 5; lap++) {
+        for (uint32_t i = 0; i < MPSC_CAPACITY; i++) {
+            test_item in = {lap, i, lap ^ i};
+            CHECK(mpsc_ring_push(&mpsc, &in), "MPSC push %u failed before full", i);
+        }
+        test_item extra = {0, 0, 0};
+        CHECK(!mpsc_ring_push(&mpsc, &extra), "pushed into a full MPSC ring");
+
+        for (uint32_t i = 0; i < MPSC_CAPACITY; i++) {
+            CHECK(mpsc_ring_pop(&mpsc, &item) && item.producer == lap && item.sequence == i,
+                  "MPSC lap %u item %u came out wrong", lap, i);
+        }
+        CHECK(mpsc_ring_empty(&mpsc), "MPSC ring not empty after draining");
+    }
+}
+
+// purpose: races PRODUCERS threads against one consumer. each producer's
+//          items must come out complete and in the order it pushed them.
+//          the consumer drains until every producer has finished, so a bad
+//          item is reported instead of leaving producers stuck on a full ring
+static void test_mpsc_stress() {
+    mpsc_ring_init(&mpsc, mpsc_storage, sizeof(test_item), MPSC_CAPACITY);
+    producers_done = 0;
+
+    pthread_t threads[PRODUCERS];
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, mpsc_producer, (void*)(uintptr_t)i);
+    }
+
+    uint32_t next[PRODUCERS] = {0};
+    uint64_t received = 0;
+    while (1) {
+        // read before popping, so items pushed before the last producer
+        // finished are still drained
+        bool finished = __atomic_load_n(&producers_done, __ATOMIC_ACQUIRE) == PRODUCERS;
+        test_item item;
+        if (!mpsc_ring_pop(&mpsc, &item)) {
+            if (finished) break;
+            sched_yield();
+            continue;
+        }
+
+        received++;
+        if (item.producer >= PRODUCERS || item.check != (item.producer ^ item.sequence)) {
+            CHECK(false, "torn item {%u, %u, %u}", item.producer, item.sequence, item.check);
+            continue;
+        }
+        CHECK(item.sequence == next[item.producer], "producer %u: got %u, expected %u",
+              item.producer, item.sequence, next[item.producer]);
+        next[item.producer] = item.sequence + 1;
+    }
+
+    for (uint32_t i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(received == (uint64_t)ITEMS_PER_PRODUCER * PRODUCERS, "received %llu items",
+          (unsigned long long)received);
+}
+
+// purpose: races one producer thread against one consumer
+static void test_spsc_stress() {
+    ring_init(&spsc, spsc_storage, sizeof(test_item), SPSC_CAPACITY);
+    producers_done = 0;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, spsc_producer, NULL);
+
+    uint32_t received = 0;
+    while (1) {
+        bool finished = __atomic_load_n(&producers_done, __ATOMIC_ACQUIRE) == 1;
+        test_item item;
+        if (!ring_pop(&spsc, &item)) {
+            if (finished) break;
+            sched_yield();
+            continue;
+        }
+        CHECK(item.sequence == received && item.check == received, "got %u, expected %u",
+              item.sequence, received);
+        received++;
+    }
+
+    pthread_join(thread, NULL);
+    CHECK(received == ITEMS_PER_PRODUCER, "received %u items", received);
+}
+
+int main() {
+    test_single_thread();
+    test_mpsc_stress();
+    test_spsc_stress();
+
+    if (failures) {
+        printf("ring_buffer_test: %d failures\n", failures);
+        return 1;
+    }
+    printf("ring_buffer_test: OK\n");
+    return 0;
+}